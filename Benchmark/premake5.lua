@@ -0,0 +1,83 @@
+project "Benchmark"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++20"
+	cdialect "C17"
+	staticruntime "On"
+
+	targetdir ("%{wks.location}/bin/" .. OutputDir .. "/%{prj.name}")
+	objdir ("%{wks.location}/bin-int/" .. OutputDir .. "/%{prj.name}")
+
+	files {
+		"src/**.h",
+		"src/**.cpp",
+
+		-- The engine is compiled in directly, minus its entry point.
+		"%{wks.location}/LearningVulkan/src/**.h",
+		"%{wks.location}/LearningVulkan/src/**.cpp",
+		"%{wks.location}/LearningVulkan/src/**.inl"
+	}
+
+	removefiles {
+		"%{wks.location}/LearningVulkan/src/main.cpp"
+	}
+
+	includedirs {
+		"src",
+		"%{wks.location}/LearningVulkan/src",
+
+		"%{IncludeDir.glfw}"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+		usestdpreproc "On"
+		buildoptions "/wd5105"
+		defines "SYSTEM_WINDOWS"
+
+		includedirs "%{IncludeDir.VulkanSDK}"
+		libdirs "%{LibraryDir.VulkanSDK}"
+
+		links {
+			"glfw",
+			"%{Library.VulkanSDK}"
+		}
+
+	-- For the nightly runs on build machines (e.g. with lavapipe). The vendored glfw only builds on Windows, so this
+	-- links the system's glfw and Vulkan loader instead (libglfw3-dev and libvulkan-dev). The headless scenes never
+	-- call into glfw, so no display server is needed.
+	filter "system:linux"
+		defines "SYSTEM_LINUX"
+
+		links {
+			"vulkan",
+			"pthread",
+			"dl"
+		}
+
+		-- Not in links, since that would refer to the glfw project.
+		linkoptions "-lglfw"
+
+	filter "configurations:Profile"
+		runtime "Debug"
+		optimize "Off"
+		symbols "On"
+		defines "CONFIG_PROFILE"
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		optimize "Debug"
+		symbols "Full"
+		defines "CONFIG_DEBUG"
+
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "On"
+		symbols "On"
+		defines "CONFIG_RELEASE"
+
+	filter "configurations:Dist"
+		runtime "Release"
+		optimize "Full"
+		symbols "Off"
+		defines "CONFIG_DIST"
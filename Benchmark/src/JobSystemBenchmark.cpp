@@ -0,0 +1,88 @@
+#include "JobSystemBenchmark.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace benchmark
+{
+	static constexpr uint32_t PARALLEL_FOR_COUNT = 1 << 20;
+	static constexpr uint32_t PARALLEL_FOR_BATCH_SIZE = 1024;
+	static constexpr uint32_t HASH_ROUNDS = 64;
+	static constexpr uint32_t TINY_JOB_COUNT = 100'000;
+
+	// Stands in for something like noise evaluation, enough work per index to be compute bound.
+	static uint64_t HashIndex(uint32_t index)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull ^ index;
+		for (uint32_t i = 0; i < HASH_ROUNDS; i++)
+		{
+			hash ^= hash >> 33;
+			hash *= 0xFF51AFD7ED558CCDull;
+			hash ^= hash >> 29;
+		}
+		return hash;
+	}
+
+	template<typename Function>
+	static double MedianMilliseconds(uint32_t repetitions, Function&& function)
+	{
+		std::vector<double> times(repetitions);
+		for (double& rTime : times)
+		{
+			auto start = std::chrono::steady_clock::now();
+			function();
+			rTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		return times[times.size() / 2];
+	}
+
+	int RunJobSystemBenchmark(uint32_t maxThreadCount, uint32_t repetitions)
+	{
+		std::vector<uint64_t> results(PARALLEL_FOR_COUNT);
+
+		std::printf("%8s %16s %10s %12s %16s %14s\n", "threads", "parallel for ms", "speedup", "efficiency", "tiny jobs ms", "ns per job");
+
+		double baselineMilliseconds = 0.0;
+		for (uint32_t threadCount = 1; threadCount <= maxThreadCount; threadCount++)
+		{
+			core::JobSystem jobSystem;
+			jobSystem.Create(threadCount - 1);
+
+			auto parallelFor = [&]()
+			{
+				core::JobCounter counter;
+				jobSystem.ParallelFor(PARALLEL_FOR_COUNT, PARALLEL_FOR_BATCH_SIZE, [&results](uint32_t begin, uint32_t end)
+				{
+					for (uint32_t i = begin; i < end; i++)
+						results[i] = HashIndex(i);
+				}, counter);
+				jobSystem.Wait(counter);
+			};
+
+			auto tinyJobs = [&]()
+			{
+				core::JobCounter counter;
+				for (uint32_t i = 0; i < TINY_JOB_COUNT; i++)
+					jobSystem.Schedule([]() {}, &counter);
+				jobSystem.Wait(counter);
+			};
+
+			parallelFor(); // Warm up.
+			double parallelForMilliseconds = MedianMilliseconds(repetitions, parallelFor);
+			double tinyJobsMilliseconds = MedianMilliseconds(repetitions, tinyJobs);
+			jobSystem.Destroy();
+
+			if (threadCount == 1)
+				baselineMilliseconds = parallelForMilliseconds;
+			double speedup = baselineMilliseconds / parallelForMilliseconds;
+
+			std::printf("%8u %16.3f %9.2fx %11.1f%% %16.3f %14.1f\n", threadCount, parallelForMilliseconds, speedup,
+				speedup / threadCount * 100.0, tinyJobsMilliseconds, tinyJobsMilliseconds * 1e6 / TINY_JOB_COUNT);
+		}
+
+		return 0;
+	}
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace benchmark
+{
+	// Measures how the job system scales from 1 to maxThreadCount threads, with a compute bound
+	// parallel for and with a flood of tiny jobs that mostly measures scheduling overhead.
+	int RunJobSystemBenchmark(uint32_t maxThreadCount, uint32_t repetitions);
+}
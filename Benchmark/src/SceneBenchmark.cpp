@@ -0,0 +1,660 @@
+#include "SceneBenchmark.h"
+#include "Core/Application.h"
+#include <assert.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <unordered_map>
+#include <vector>
+
+namespace benchmark
+{
+	static constexpr int32_t CHUNK_SIZE = 16;
+	static constexpr int32_t CHUNK_HEIGHT = 128;
+	static constexpr uint32_t CHUNK_BLOCK_COUNT = CHUNK_SIZE * CHUNK_SIZE * CHUNK_HEIGHT;
+	static constexpr VkDeviceSize CHUNK_BYTES = CHUNK_BLOCK_COUNT * sizeof(uint16_t);
+	// Streaming is spread over several frames like the game would, so a teleport shows up as a run of slower frames.
+	static constexpr uint32_t MAX_CHUNK_LOADS_PER_FRAME = 32;
+	static constexpr float PI = std::numbers::pi_v<float>;
+	static constexpr float FIELD_OF_VIEW = PI / 2.0f;
+	static constexpr VkDeviceSize COMPUTE_BUFFER_SIZE = 4ull << 20;
+	// Every device supports both for what the post process passes use them for.
+	static constexpr VkFormat BLOOM_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	static constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D16_UNORM;
+	// The downsample chain alternates between these every 120 frames.
+	static constexpr uint32_t MIN_BLOOM_DOWNSAMPLES = 2;
+	static constexpr uint32_t MAX_BLOOM_DOWNSAMPLES = 3;
+	static constexpr const char* BLOOM_LEVEL_NAMES[MAX_BLOOM_DOWNSAMPLES + 1] = { "Bloom Level 0", "Bloom Level 1", "Bloom Level 2", "Bloom Level 3" };
+
+	static constexpr uint16_t BLOCK_AIR = 0;
+	static constexpr uint16_t BLOCK_STONE = 1;
+	static constexpr uint16_t BLOCK_DIRT = 2;
+	static constexpr uint16_t BLOCK_GRASS = 3;
+
+	// In blocks. A yaw of 0 looks down +x.
+	struct CameraPose
+	{
+		float x = 0.0f;
+		float z = 0.0f;
+		float yaw = 0.0f;
+	};
+
+	using CameraPath = CameraPose(*)(uint64_t frameNumber);
+
+	struct SceneDescription
+	{
+		const char* cpName;
+		const char* cpDescription;
+		CameraPath cameraPath;
+		// In chunks.
+		int32_t viewDistance;
+		bool asyncCompute;
+		// Adds a bloom chain and a depth target in the render graph's transient memory.
+		bool postProcess;
+	};
+
+	static CameraPose StaticPath(uint64_t frameNumber)
+	{
+		return {};
+	}
+
+	static CameraPose FlyoverPath(uint64_t frameNumber)
+	{
+		// A new row of chunks every 8 frames.
+		return { static_cast<float>(frameNumber) * 2.0f, 0.0f, 0.0f };
+	}
+
+	static CameraPose OrbitPath(uint64_t frameNumber)
+	{
+		// One lap every 600 frames, looking along the path.
+		float angle = 2.0f * PI * static_cast<float>(frameNumber % 600) / 600.0f;
+		return { 128.0f * std::cos(angle), 128.0f * std::sin(angle), angle + PI / 2.0f };
+	}
+
+	static CameraPose TeleportPath(uint64_t frameNumber)
+	{
+		// Jumps past the view distance every 240 frames, and looks around in between.
+		return { static_cast<float>(frameNumber / 240) * 1024.0f, 0.0f, static_cast<float>(frameNumber % 240) * 0.02f };
+	}
+
+	static constexpr SceneDescription SCENES[] =
+	{
+		{ "static", "Stands still, so nothing streams after the first few frames.", StaticPath, 12, false, false },
+		{ "flyover", "Flies in a straight line, streaming in a row of chunks every 8 frames.", FlyoverPath, 12, false, false },
+		{ "orbit", "Circles around while turning, streaming at the edge of the view distance.", OrbitPath, 12, false, false },
+		{ "teleport", "Jumps past the view distance every 240 frames, reloading everything in bursts.", TeleportPath, 12, false, false },
+		{ "async-compute", "The flyover, plus compute work every frame that the graphics queue waits on.", FlyoverPath, 12, true, false },
+		{ "post-process", "The orbit, plus a bloom chain and a depth target the render graph aliases in transient memory.", OrbitPath, 12, false, true }
+	};
+
+	static uint64_t GetChunkKey(int32_t chunkX, int32_t chunkZ)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32) | static_cast<uint32_t>(chunkZ);
+	}
+
+	static uint32_t HashColumn(int32_t x, int32_t z)
+	{
+		uint32_t hash = static_cast<uint32_t>(x) * 0x8DA6B343u ^ static_cast<uint32_t>(z) * 0xD8163841u;
+		hash ^= hash >> 15;
+		hash *= 0x2C1B3C6Du;
+		hash ^= hash >> 12;
+		return hash;
+	}
+
+	// Stands in for the world until there's a renderer. Chunks around the camera are generated on the job system and
+	// uploaded, and every visible chunk records the viewport and scissor its draw would use, split across render tasks.
+	class Scene
+	{
+	public:
+		Scene(const SceneDescription& crDescription, VkExtent2D extent) : m_crDescription(crDescription), m_Extent(extent) {}
+
+		void Create(core::Application& rApplication);
+		void Destroy();
+
+		void Update(uint64_t frameNumber);
+
+		inline uint64_t GetLoadedChunkCount() const noexcept { return m_LoadedChunkCount; }
+	private:
+		struct PendingLoad
+		{
+			int32_t chunkX = 0;
+			int32_t chunkZ = 0;
+			int32_t distanceSquared = 0;
+			uint32_t slot = 0;
+		};
+
+		struct VisibleChunk
+		{
+			VkViewport viewport{};
+			VkRect2D scissor{};
+		};
+	private:
+		VkBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, rendering::Allocation& rAllocation);
+		bool IsInViewDistance(int32_t chunkX, int32_t chunkZ) const;
+		void LoadChunks();
+		void UpdateVisibleChunks(const CameraPose& crPose);
+		void RecordRenderTask(VkCommandBuffer pCommandBuffer, uint32_t taskIndex, uint32_t taskCount) const;
+		void AddPostProcessPasses(rendering::RenderGraph& rGraph, const core::FrameColorTarget& crColorTarget);
+		static void GenerateChunk(int32_t chunkX, int32_t chunkZ, uint16_t* pBlocks);
+	private:
+		const SceneDescription& m_crDescription;
+		core::Application* m_pApplication = nullptr;
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const rendering::DeviceDispatch* m_cpDispatch = nullptr;
+		VkExtent2D m_Extent{};
+
+		// Every resident chunk has a slot of CHUNK_BYTES in here. Only the transfer queue touches it, since nothing
+		// draws from it yet.
+		VkBuffer m_pChunkBuffer = VK_NULL_HANDLE;
+		rendering::Allocation m_ChunkBufferAllocation;
+		std::unordered_map<uint64_t, uint32_t> m_ResidentChunks;
+		std::vector<uint32_t> m_FreeSlots;
+		std::vector<PendingLoad> m_PendingLoads;
+		std::vector<uint16_t> m_GeneratedBlocks;
+		uint64_t m_LoadedChunkCount = 0;
+		int32_t m_CameraChunkX = 0;
+		int32_t m_CameraChunkZ = 0;
+
+		// Written by Update() before the frame is recorded, only read by the render tasks.
+		std::vector<VisibleChunk> m_VisibleChunks;
+
+		VkBuffer m_pComputeBuffer = VK_NULL_HANDLE;
+		rendering::Allocation m_ComputeBufferAllocation;
+
+		uint32_t m_BloomDownsampleCount = MIN_BLOOM_DOWNSAMPLES;
+	};
+
+	void Scene::Create(core::Application& rApplication)
+	{
+		m_pApplication = &rApplication;
+		m_pDevice = rApplication.GetDevice();
+		m_cpDispatch = &rApplication.GetDeviceDispatch();
+
+		int32_t slotsPerSide = m_crDescription.viewDistance * 2 + 1;
+		uint32_t slotCount = static_cast<uint32_t>(slotsPerSide * slotsPerSide);
+		m_pChunkBuffer = CreateBuffer(slotCount * CHUNK_BYTES, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_ChunkBufferAllocation);
+		m_FreeSlots.resize(slotCount);
+		for (uint32_t i = 0; i < slotCount; i++)
+			m_FreeSlots[i] = slotCount - 1 - i;
+		m_GeneratedBlocks.resize(MAX_CHUNK_LOADS_PER_FRAME * CHUNK_BLOCK_COUNT);
+
+		if (m_crDescription.asyncCompute)
+			m_pComputeBuffer = CreateBuffer(COMPUTE_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_ComputeBufferAllocation);
+
+		// One task per job system thread, so recording is spread over all of them.
+		uint32_t taskCount = rApplication.GetJobSystem().GetThreadCount();
+		for (uint32_t i = 0; i < taskCount; i++)
+			rApplication.AddRenderTask([this, i, taskCount](VkCommandBuffer pCommandBuffer) { RecordRenderTask(pCommandBuffer, i, taskCount); });
+
+		if (m_crDescription.postProcess)
+		{
+			rApplication.AddRenderGraphCallback([this](rendering::RenderGraph& rGraph, const core::FrameColorTarget& crColorTarget)
+			{
+				AddPostProcessPasses(rGraph, crColorTarget);
+			});
+		}
+	}
+
+	void Scene::Destroy()
+	{
+		// Application::Run() waits for the device to be idle before returning.
+		rendering::DeviceAllocator& rAllocator = m_pApplication->GetDeviceAllocator();
+		if (m_pComputeBuffer != VK_NULL_HANDLE)
+		{
+			m_cpDispatch->vkDestroyBuffer(m_pDevice, m_pComputeBuffer, m_cpDispatch->cpAllocationCallbacks);
+			rAllocator.Free(m_ComputeBufferAllocation);
+		}
+		m_cpDispatch->vkDestroyBuffer(m_pDevice, m_pChunkBuffer, m_cpDispatch->cpAllocationCallbacks);
+		rAllocator.Free(m_ChunkBufferAllocation);
+	}
+
+	void Scene::Update(uint64_t frameNumber)
+	{
+		CameraPose pose = m_crDescription.cameraPath(frameNumber);
+		m_CameraChunkX = static_cast<int32_t>(std::floor(pose.x / CHUNK_SIZE));
+		m_CameraChunkZ = static_cast<int32_t>(std::floor(pose.z / CHUNK_SIZE));
+
+		LoadChunks();
+		UpdateVisibleChunks(pose);
+
+		// Changing the chain makes the render graph retire its transient images and place new ones.
+		m_BloomDownsampleCount = (frameNumber / 120) % 2 == 0 ? MIN_BLOOM_DOWNSAMPLES : MAX_BLOOM_DOWNSAMPLES;
+
+		if (m_crDescription.asyncCompute)
+		{
+			rendering::ComputeQueue& rComputeQueue = m_pApplication->GetComputeQueue();
+			uint64_t computeValue = rComputeQueue.Submit([this, frameNumber](VkCommandBuffer pCommandBuffer)
+			{
+				// The previous frame's fill may still be writing.
+				VkMemoryBarrier2 memoryBarrier{};
+				memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+				memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+				memoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+				memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+				memoryBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+				VkDependencyInfo dependencyInfo{};
+				dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+				dependencyInfo.memoryBarrierCount = 1;
+				dependencyInfo.pMemoryBarriers = &memoryBarrier;
+				m_cpDispatch->vkCmdPipelineBarrier2(pCommandBuffer, &dependencyInfo);
+				m_cpDispatch->vkCmdFillBuffer(pCommandBuffer, m_pComputeBuffer, 0, VK_WHOLE_SIZE, static_cast<uint32_t>(frameNumber));
+			});
+			m_pApplication->AddFrameWait({ rComputeQueue.GetTimelineSemaphore(), computeValue, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT });
+		}
+	}
+
+	VkBuffer Scene::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, rendering::Allocation& rAllocation)
+	{
+		VkBufferCreateInfo bufferCreateInfo{};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = size;
+		bufferCreateInfo.usage = usage;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkBuffer pBuffer = VK_NULL_HANDLE;
+		VkResult result = m_cpDispatch->vkCreateBuffer(m_pDevice, &bufferCreateInfo, m_cpDispatch->cpAllocationCallbacks, &pBuffer);
+		assert(result == VK_SUCCESS && "Failed to create benchmark buffer.");
+		rAllocation = m_pApplication->GetDeviceAllocator().AllocateBuffer(pBuffer, {});
+		return pBuffer;
+	}
+
+	bool Scene::IsInViewDistance(int32_t chunkX, int32_t chunkZ) const
+	{
+		int32_t dx = chunkX - m_CameraChunkX;
+		int32_t dz = chunkZ - m_CameraChunkZ;
+		return dx * dx + dz * dz <= m_crDescription.viewDistance * m_crDescription.viewDistance;
+	}
+
+	void Scene::LoadChunks()
+	{
+		// Frames in flight may still read an unloaded chunk's slot, so it's only reused once they're done.
+		rendering::DeletionQueue& rDeletionQueue = m_pApplication->GetDeletionQueue();
+		rendering::TimelinePoint unloadPoint = m_pApplication->GetFrameTimelinePoint();
+		for (auto it = m_ResidentChunks.begin(); it != m_ResidentChunks.end();)
+		{
+			int32_t chunkX = static_cast<int32_t>(it->first >> 32);
+			int32_t chunkZ = static_cast<int32_t>(static_cast<uint32_t>(it->first));
+			if (IsInViewDistance(chunkX, chunkZ))
+				++it;
+			else
+			{
+				rDeletionQueue.Retire(unloadPoint, [this, slot = it->second]() { m_FreeSlots.push_back(slot); });
+				it = m_ResidentChunks.erase(it);
+			}
+		}
+
+		// Nearest first, so the chunks around the camera are there before the ones at the edge.
+		m_PendingLoads.clear();
+		int32_t viewDistance = m_crDescription.viewDistance;
+		for (int32_t dz = -viewDistance; dz <= viewDistance; dz++)
+		{
+			for (int32_t dx = -viewDistance; dx <= viewDistance; dx++)
+			{
+				int32_t chunkX = m_CameraChunkX + dx;
+				int32_t chunkZ = m_CameraChunkZ + dz;
+				if (IsInViewDistance(chunkX, chunkZ) && !m_ResidentChunks.contains(GetChunkKey(chunkX, chunkZ)))
+					m_PendingLoads.push_back({ chunkX, chunkZ, dx * dx + dz * dz });
+			}
+		}
+		// After a teleport, most slots are still waiting to be released, so the rest load over the next frames.
+		size_t loadCount = std::min<size_t>({ m_PendingLoads.size(), MAX_CHUNK_LOADS_PER_FRAME, m_FreeSlots.size() });
+		if (loadCount == 0)
+			return;
+		std::partial_sort(m_PendingLoads.begin(), m_PendingLoads.begin() + loadCount, m_PendingLoads.end(),
+			[](const PendingLoad& crA, const PendingLoad& crB) { return crA.distanceSquared < crB.distanceSquared; });
+		m_PendingLoads.resize(loadCount);
+
+		for (PendingLoad& rLoad : m_PendingLoads)
+		{
+			rLoad.slot = m_FreeSlots.back();
+			m_FreeSlots.pop_back();
+			m_ResidentChunks.emplace(GetChunkKey(rLoad.chunkX, rLoad.chunkZ), rLoad.slot);
+		}
+
+		// The uploads are flushed and waited on by this frame's submit.
+		core::JobSystem& rJobSystem = m_pApplication->GetJobSystem();
+		rendering::UploadService& rUploadService = m_pApplication->GetUploadService();
+		core::JobCounter counter;
+		rJobSystem.ParallelFor(static_cast<uint32_t>(loadCount), 1, [this, &rUploadService](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+			{
+				const PendingLoad& crLoad = m_PendingLoads[i];
+				uint16_t* pBlocks = m_GeneratedBlocks.data() + static_cast<size_t>(i) * CHUNK_BLOCK_COUNT;
+				GenerateChunk(crLoad.chunkX, crLoad.chunkZ, pBlocks);
+				rUploadService.UploadBuffer(m_pChunkBuffer, crLoad.slot * CHUNK_BYTES, pBlocks, CHUNK_BYTES);
+			}
+		}, counter);
+		rJobSystem.Wait(counter);
+		m_LoadedChunkCount += loadCount;
+	}
+
+	void Scene::UpdateVisibleChunks(const CameraPose& crPose)
+	{
+		// Projects each chunk to a square on screen, sized by its distance, for its viewport and scissor.
+		float width = static_cast<float>(m_Extent.width);
+		float height = static_cast<float>(m_Extent.height);
+		float focalLength = width / (2.0f * std::tan(FIELD_OF_VIEW / 2.0f));
+
+		m_VisibleChunks.clear();
+		for (const auto& [key, slot] : m_ResidentChunks)
+		{
+			float centerX = static_cast<float>(static_cast<int32_t>(key >> 32)) * CHUNK_SIZE + CHUNK_SIZE / 2.0f;
+			float centerZ = static_cast<float>(static_cast<int32_t>(static_cast<uint32_t>(key))) * CHUNK_SIZE + CHUNK_SIZE / 2.0f;
+			float dx = centerX - crPose.x;
+			float dz = centerZ - crPose.z;
+			float distance = std::max(std::sqrt(dx * dx + dz * dz), 1.0f);
+
+			// Chunks the camera is in are always visible, the rest if any part of them is within the field of view.
+			float angle = std::remainder(std::atan2(dz, dx) - crPose.yaw, 2.0f * PI);
+			float angularRadius = std::atan(CHUNK_SIZE / distance);
+			if (distance > CHUNK_SIZE * 2 && std::abs(angle) > FIELD_OF_VIEW / 2.0f + angularRadius)
+				continue;
+
+			float size = std::clamp(CHUNK_SIZE * focalLength / distance, 1.0f, width);
+			float centerScreenX = width / 2.0f + std::tan(std::clamp(angle, -FIELD_OF_VIEW / 2.0f, FIELD_OF_VIEW / 2.0f)) * focalLength;
+
+			VisibleChunk& rChunk = m_VisibleChunks.emplace_back();
+			rChunk.viewport = { centerScreenX - size / 2.0f, (height - size) / 2.0f, size, size, 0.0f, 1.0f };
+
+			float left = std::clamp(rChunk.viewport.x, 0.0f, width);
+			float top = std::clamp(rChunk.viewport.y, 0.0f, height);
+			float right = std::clamp(rChunk.viewport.x + size, left, width);
+			float bottom = std::clamp(rChunk.viewport.y + size, top, height);
+			rChunk.scissor.offset = { static_cast<int32_t>(left), static_cast<int32_t>(top) };
+			rChunk.scissor.extent = { static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top) };
+		}
+	}
+
+	void Scene::RecordRenderTask(VkCommandBuffer pCommandBuffer, uint32_t taskIndex, uint32_t taskCount) const
+	{
+		size_t begin = m_VisibleChunks.size() * taskIndex / taskCount;
+		size_t end = m_VisibleChunks.size() * (taskIndex + 1) / taskCount;
+		for (size_t i = begin; i < end; i++)
+		{
+			m_cpDispatch->vkCmdSetViewport(pCommandBuffer, 0, 1, &m_VisibleChunks[i].viewport);
+			m_cpDispatch->vkCmdSetScissor(pCommandBuffer, 0, 1, &m_VisibleChunks[i].scissor);
+		}
+	}
+
+	void Scene::AddPostProcessPasses(rendering::RenderGraph& rGraph, const core::FrameColorTarget& crColorTarget)
+	{
+		// Stands in for bloom until there's a renderer: a half resolution prefilter, downsampled a few times, then
+		// composited on top of the frame with a depth test. Each level is only alive until the next one is made from
+		// it, so the render graph puts every other level in the same memory.
+		VkExtent2D extent{ std::max(crColorTarget.extent.width / 2, 1u), std::max(crColorTarget.extent.height / 2, 1u) };
+		rendering::RenderResource level = rGraph.CreateImage(BLOOM_LEVEL_NAMES[0], { BLOOM_FORMAT, extent });
+		rGraph.AddPass("Bloom Prefilter", [this, &rGraph, level, extent](VkCommandBuffer pCommandBuffer)
+		{
+			VkRenderingAttachmentInfo colorAttachmentInfo{};
+			colorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			colorAttachmentInfo.imageView = rGraph.GetImageView(level);
+			colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			colorAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.renderArea = { { 0, 0 }, extent };
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colorAttachmentInfo;
+
+			m_cpDispatch->vkCmdBeginRendering(pCommandBuffer, &renderingInfo);
+			m_cpDispatch->vkCmdEndRendering(pCommandBuffer);
+		}).Use(level, rendering::ResourceUsage::ColorAttachmentWrite);
+
+		for (uint32_t i = 1; i <= m_BloomDownsampleCount; i++)
+		{
+			VkExtent2D nextExtent{ std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u) };
+			rendering::RenderResource nextLevel = rGraph.CreateImage(BLOOM_LEVEL_NAMES[i], { BLOOM_FORMAT, nextExtent });
+			rGraph.AddPass("Bloom Downsample", [this, &rGraph, level, nextLevel, extent, nextExtent](VkCommandBuffer pCommandBuffer)
+			{
+				VkImageBlit imageBlit{};
+				imageBlit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				imageBlit.srcOffsets[1] = { static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1 };
+				imageBlit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				imageBlit.dstOffsets[1] = { static_cast<int32_t>(nextExtent.width), static_cast<int32_t>(nextExtent.height), 1 };
+				m_cpDispatch->vkCmdBlitImage(pCommandBuffer, rGraph.GetImage(level), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					rGraph.GetImage(nextLevel), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageBlit, VK_FILTER_LINEAR);
+			}).Use(level, rendering::ResourceUsage::TransferRead).Use(nextLevel, rendering::ResourceUsage::TransferWrite);
+
+			level = nextLevel;
+			extent = nextExtent;
+		}
+
+		// Only ever an attachment, so it's lazily allocated where the device supports it.
+		rendering::RenderResource depth = rGraph.CreateImage("Composite Depth", { DEPTH_FORMAT, crColorTarget.extent, VK_IMAGE_ASPECT_DEPTH_BIT });
+		rGraph.AddPass("Bloom Composite", [this, &rGraph, depth, colorTarget = crColorTarget](VkCommandBuffer pCommandBuffer)
+		{
+			VkRenderingAttachmentInfo colorAttachmentInfo{};
+			colorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			colorAttachmentInfo.imageView = colorTarget.pImageView;
+			colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			colorAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			VkRenderingAttachmentInfo depthAttachmentInfo{};
+			depthAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			depthAttachmentInfo.imageView = rGraph.GetImageView(depth);
+			depthAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			depthAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			depthAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			depthAttachmentInfo.clearValue.depthStencil = { 1.0f, 0 };
+
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.renderArea = { { 0, 0 }, colorTarget.extent };
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colorAttachmentInfo;
+			renderingInfo.pDepthAttachment = &depthAttachmentInfo;
+
+			// Nothing samples the last level yet, but the pass declares the read the composite will need.
+			m_cpDispatch->vkCmdBeginRendering(pCommandBuffer, &renderingInfo);
+			m_cpDispatch->vkCmdEndRendering(pCommandBuffer);
+		}).Use(crColorTarget.resource, rendering::ResourceUsage::ColorAttachmentReadWrite)
+			.Use(depth, rendering::ResourceUsage::DepthStencilAttachmentWrite)
+			.Use(level, rendering::ResourceUsage::FragmentShaderRead);
+	}
+
+	void Scene::GenerateChunk(int32_t chunkX, int32_t chunkZ, uint16_t* pBlocks)
+	{
+		// Rolling hills with a bit of per column noise, laid out y, then z, then x.
+		for (int32_t z = 0; z < CHUNK_SIZE; z++)
+		{
+			for (int32_t x = 0; x < CHUNK_SIZE; x++)
+			{
+				int32_t worldX = chunkX * CHUNK_SIZE + x;
+				int32_t worldZ = chunkZ * CHUNK_SIZE + z;
+				float hills = std::sin(static_cast<float>(worldX) * 0.05f) + std::cos(static_cast<float>(worldZ) * 0.05f);
+				int32_t surfaceHeight = 48 + static_cast<int32_t>(hills * 8.0f) + static_cast<int32_t>(HashColumn(worldX, worldZ) & 3);
+
+				for (int32_t y = 0; y < CHUNK_HEIGHT; y++)
+				{
+					uint16_t block = BLOCK_AIR;
+					if (y < surfaceHeight - 4)
+						block = BLOCK_STONE;
+					else if (y < surfaceHeight - 1)
+						block = BLOCK_DIRT;
+					else if (y < surfaceHeight)
+						block = BLOCK_GRASS;
+					pBlocks[(y * CHUNK_SIZE + z) * CHUNK_SIZE + x] = block;
+				}
+			}
+		}
+	}
+
+	struct SceneResult
+	{
+		const SceneDescription* cpDescription = nullptr;
+		uint64_t frameCount = 0;
+		double wallSeconds = 0.0;
+		double timeToFirstFrameMilliseconds = 0.0;
+		uint64_t loadedChunkCount = 0;
+		// Only counts what happened while running, not startup.
+		std::array<double, rendering::HostAllocator::SCOPE_COUNT> hostAllocationsPerFrame{};
+		rendering::TransientMemoryStatistics transientMemory;
+		std::array<core::FrameMetricSummary, static_cast<size_t>(core::FrameMetric::Count)> metrics;
+	};
+
+	static void WriteJsonString(std::ostream& rStream, const char* cpString)
+	{
+		rStream << '"';
+		for (const char* cpCharacter = cpString; *cpCharacter; cpCharacter++)
+		{
+			if (*cpCharacter == '"' || *cpCharacter == '\\')
+				rStream << '\\' << *cpCharacter;
+			else if (static_cast<unsigned char>(*cpCharacter) >= 0x20)
+				rStream << *cpCharacter;
+		}
+		rStream << '"';
+	}
+
+	static void WriteResults(std::ostream& rStream, const SceneBenchmarkSettings& crSettings, const VkPhysicalDeviceProperties& crDeviceProperties,
+		const std::vector<SceneResult>& crResults)
+	{
+		char number[64];
+		auto formatMilliseconds = [&number](double milliseconds) { std::snprintf(number, sizeof(number), "%.3f", milliseconds); return number; };
+
+		// Versions are reported raw, since how driverVersion is packed differs per vendor.
+		rStream << "{\n\t\"device\": ";
+		WriteJsonString(rStream, crDeviceProperties.deviceName);
+		rStream << ",\n\t\"vendorID\": " << crDeviceProperties.vendorID <<
+			",\n\t\"driverVersion\": " << crDeviceProperties.driverVersion <<
+			",\n\t\"apiVersion\": " << crDeviceProperties.apiVersion <<
+			",\n\t\"extent\": [" << crSettings.extent.width << ", " << crSettings.extent.height << "]" <<
+			",\n\t\"readback\": " << (crSettings.readback ? "true" : "false") <<
+			",\n\t\"scenes\": [";
+
+		for (size_t i = 0; i < crResults.size(); i++)
+		{
+			const SceneResult& crResult = crResults[i];
+			rStream << (i == 0 ? "\n" : ",\n") << "\t\t{\n\t\t\t\"name\": ";
+			WriteJsonString(rStream, crResult.cpDescription->cpName);
+			rStream << ",\n\t\t\t\"frames\": " << crResult.frameCount;
+			std::snprintf(number, sizeof(number), "%.3f", crResult.wallSeconds);
+			rStream << ",\n\t\t\t\"wall_seconds\": " << number;
+			std::snprintf(number, sizeof(number), "%.2f", crResult.wallSeconds > 0.0 ? crResult.frameCount / crResult.wallSeconds : 0.0);
+			rStream << ",\n\t\t\t\"average_fps\": " << number;
+			rStream << ",\n\t\t\t\"time_to_first_frame_ms\": " << formatMilliseconds(crResult.timeToFirstFrameMilliseconds);
+			rStream << ",\n\t\t\t\"chunk_loads\": " << crResult.loadedChunkCount;
+			rStream << ",\n\t\t\t\"host_allocations_per_frame\": {";
+			for (size_t scope = 0; scope < crResult.hostAllocationsPerFrame.size(); scope++)
+			{
+				std::snprintf(number, sizeof(number), "%.2f", crResult.hostAllocationsPerFrame[scope]);
+				rStream << (scope == 0 ? "" : ", ") << '"' << rendering::HostAllocator::GetScopeName(static_cast<VkSystemAllocationScope>(scope)) << "\": " << number;
+			}
+			rStream << '}';
+			rStream << ",\n\t\t\t\"transient_memory\": { \"peak_required_bytes\": " << crResult.transientMemory.peakRequiredBytes <<
+				", \"peak_allocated_bytes\": " << crResult.transientMemory.peakAllocatedBytes <<
+				", \"lazily_allocated_bytes\": " << crResult.transientMemory.lazilyAllocatedBytes << " }";
+			rStream << ",\n\t\t\t\"metrics_ms\": {";
+
+			// Metrics without samples (e.g. acquire wait, since there's no swap chain) are left out.
+			bool firstMetric = true;
+			for (size_t metric = 0; metric < crResult.metrics.size(); metric++)
+			{
+				const core::FrameMetricSummary& crSummary = crResult.metrics[metric];
+				if (crSummary.sampleCount == 0)
+					continue;
+
+				rStream << (firstMetric ? "\n" : ",\n") << "\t\t\t\t";
+				WriteJsonString(rStream, core::FrameStatistics::GetMetricName(static_cast<core::FrameMetric>(metric)));
+				rStream << ": { \"samples\": " << crSummary.sampleCount;
+				rStream << ", \"p50\": " << formatMilliseconds(crSummary.p50);
+				rStream << ", \"p95\": " << formatMilliseconds(crSummary.p95);
+				rStream << ", \"p99\": " << formatMilliseconds(crSummary.p99);
+				rStream << ", \"max\": " << formatMilliseconds(crSummary.max) << " }";
+				firstMetric = false;
+			}
+			rStream << "\n\t\t\t}\n\t\t}";
+		}
+		rStream << "\n\t]\n}\n";
+	}
+
+	void PrintSceneNames(std::ostream& rStream)
+	{
+		for (const SceneDescription& crScene : SCENES)
+			rStream << "      " << crScene.cpName << ": " << crScene.cpDescription << '\n';
+	}
+
+	int RunSceneBenchmarks(const SceneBenchmarkSettings& crSettings)
+	{
+		std::vector<SceneResult> results;
+		VkPhysicalDeviceProperties deviceProperties{};
+
+		for (const SceneDescription& crDescription : SCENES)
+		{
+			if (!crSettings.sceneName.empty() && crSettings.sceneName != crDescription.cpName)
+				continue;
+
+			std::cerr << "Running scene \"" << crDescription.cpName << "\" for " << crSettings.frameCount << " frames.\n";
+
+			Scene scene(crDescription, crSettings.extent);
+
+			core::ApplicationSpecification specification;
+			specification.headless = true;
+			specification.headlessExtent = crSettings.extent;
+			specification.frameLimit = crSettings.frameCount;
+			specification.preferredDevice = crSettings.preferredDevice;
+			specification.frameCallback = [&scene](uint64_t frameNumber) { scene.Update(frameNumber); };
+			// The copy is what's being measured, the pixels themselves don't matter.
+			if (crSettings.readback)
+				specification.readbackCallback = [](const void*, VkExtent2D, VkFormat) {};
+
+			std::unique_ptr<core::Application> pApplication = std::make_unique<core::Application>(specification);
+			scene.Create(*pApplication);
+
+			rendering::HostAllocator::Statistics startHostStatistics = pApplication->GetHostAllocator().GetStatistics();
+			auto startTime = std::chrono::steady_clock::now();
+			pApplication->Run();
+			double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			rendering::HostAllocator::Statistics endHostStatistics = pApplication->GetHostAllocator().GetStatistics();
+
+			SceneResult& rResult = results.emplace_back();
+			rResult.cpDescription = &crDescription;
+			rResult.frameCount = crSettings.frameCount;
+			rResult.wallSeconds = wallSeconds;
+			rResult.timeToFirstFrameMilliseconds = pApplication->GetStartupStatistics().GetTimeToFirstFrameMilliseconds();
+			rResult.loadedChunkCount = scene.GetLoadedChunkCount();
+			for (size_t i = 0; i < rResult.hostAllocationsPerFrame.size(); i++)
+				rResult.hostAllocationsPerFrame[i] = static_cast<double>(endHostStatistics.scopes[i].allocationCount - startHostStatistics.scopes[i].allocationCount) / crSettings.frameCount;
+			rResult.transientMemory = pApplication->GetTransientMemoryStatistics();
+			for (size_t i = 0; i < rResult.metrics.size(); i++)
+				rResult.metrics[i] = pApplication->GetFrameStatistics().GetSessionSummary(static_cast<core::FrameMetric>(i));
+			deviceProperties = pApplication->GetPhysicalDeviceProperties();
+
+			scene.Destroy();
+			pApplication.reset();
+		}
+
+		if (results.empty())
+		{
+			std::cerr << "Unknown scene \"" << crSettings.sceneName << "\".\n";
+			return 1;
+		}
+
+		if (crSettings.outputFilepath.empty())
+		{
+			WriteResults(std::cout, crSettings, deviceProperties, results);
+			return 0;
+		}
+
+		std::ofstream file(crSettings.outputFilepath);
+		if (!file)
+		{
+			std::cerr << "Failed to open \"" << crSettings.outputFilepath.string() << "\".\n";
+			return 1;
+		}
+		WriteResults(file, crSettings, deviceProperties, results);
+		return 0;
+	}
+}
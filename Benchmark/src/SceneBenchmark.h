@@ -0,0 +1,31 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+
+namespace benchmark
+{
+	struct SceneBenchmarkSettings
+	{
+		uint64_t frameCount = 1000;
+		VkExtent2D extent{ 1280, 720 };
+		// Runs every scene if empty.
+		std::string sceneName;
+		// Same as ApplicationSpecification::preferredDevice.
+		std::string preferredDevice;
+		// Also copy every frame back to the host, like a screenshot test would.
+		bool readback = false;
+		// The results are written here as JSON, or to stdout if empty.
+		std::filesystem::path outputFilepath;
+	};
+
+	void PrintSceneNames(std::ostream& rStream);
+
+	// Runs each scene in its own headless Application for frameCount frames. Scenes are scripted by frame number,
+	// not by time, so every run does the same work no matter how fast the device is.
+	int RunSceneBenchmarks(const SceneBenchmarkSettings& crSettings);
+}
@@ -0,0 +1,75 @@
+#include "JobSystemBenchmark.h"
+#include "SceneBenchmark.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+static void PrintUsage()
+{
+	std::cerr << "Usage: Benchmark <benchmark> [options]\n"
+		"\n"
+		"Benchmarks:\n"
+		"  jobs [--max-threads <count>] [--repetitions <count>]\n"
+		"      Job system scaling from 1 to max-threads threads (default: hardware concurrency).\n"
+		"  scenes [--frames <count>] [--scene <name>] [--extent <width> <height>] [--device <name|uuid>] [--readback] [--output <file>]\n"
+		"      Runs scripted scenes headless for the given frames each (default: 1000) and writes their frame time\n"
+		"      percentiles as JSON to the output file, or to stdout. Progress and engine logs go to stderr. Scenes:\n";
+	benchmark::PrintSceneNames(std::cerr);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	if (strcmp(argv[1], "jobs") == 0)
+	{
+		uint32_t maxThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+		uint32_t repetitions = 5;
+		for (int i = 2; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc)
+				maxThreadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			else if (strcmp(argv[i], "--repetitions") == 0 && i + 1 < argc)
+				repetitions = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		return benchmark::RunJobSystemBenchmark(std::max(maxThreadCount, 1u), std::max(repetitions, 1u));
+	}
+
+	if (strcmp(argv[1], "scenes") == 0)
+	{
+		benchmark::SceneBenchmarkSettings settings;
+		for (int i = 2; i < argc; i++)
+		{
+			if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+				settings.frameCount = std::strtoull(argv[++i], nullptr, 10);
+			else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+				settings.sceneName = argv[++i];
+			else if (strcmp(argv[i], "--extent") == 0 && i + 2 < argc)
+			{
+				settings.extent.width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+				settings.extent.height = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)
+				settings.preferredDevice = argv[++i];
+			else if (strcmp(argv[i], "--readback") == 0)
+				settings.readback = true;
+			else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+				settings.outputFilepath = argv[++i];
+		}
+		if (settings.frameCount == 0 || settings.extent.width == 0 || settings.extent.height == 0)
+		{
+			PrintUsage();
+			return 1;
+		}
+		return benchmark::RunSceneBenchmarks(settings);
+	}
+
+	PrintUsage();
+	return 1;
+}
@@ -1,165 +1,179 @@
 #include "Core/Application.h"
+#include "Core/Profiler.h"
 #include <assert.h>
 #include <iostream>
 #include <unordered_map>
 #include <optional>
-#include <unordered_set>
 #include <array>
 #include <algorithm>
+#include <span>
+#include <string>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <chrono>
+
+// Higher is better. Device type dominates: every type is worth more than everything else a device can score put together,
+// so e.g. an integrated GPU never beats a discrete one just because it shares more memory.
+static int64_t ScorePhysicalDevice(const VkPhysicalDeviceProperties& crProperties, const VkPhysicalDeviceMemoryProperties& crMemoryProperties,
+	const std::vector<VkQueueFamilyProperties>& crQueueFamilies, size_t optionalExtensionCount)
+{
+	static constexpr int64_t DEVICE_TYPE_WEIGHT = 10000;
 
-static std::unordered_map<const char*, PFN_vkVoidFunction> s_VulkanExtensionFunctions;
+	int64_t typeRank = 0;
+	switch (crProperties.deviceType)
+	{
+		case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: typeRank = 4; break;
+		case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: typeRank = 3; break;
+		case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: typeRank = 2; break;
+		case VK_PHYSICAL_DEVICE_TYPE_CPU: typeRank = 1; break;
+		default: break;
+	}
 
-template<typename PFN, typename Ret, typename... Args>
-static Ret vkCallFunctionEXT_IMPL(VkInstance pInstance, const char* cpFunctionName, Args&&... args)
-{
-	PFN_vkVoidFunction fFunction;
+	int64_t score = 0;
+
+	// The biggest device local heap, capped at 32 GiB.
+	VkDeviceSize largestDeviceLocalHeap = 0;
+	for (uint32_t i = 0; i < crMemoryProperties.memoryHeapCount; i++)
+		if (crMemoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			largestDeviceLocalHeap = std::max(largestDeviceLocalHeap, crMemoryProperties.memoryHeaps[i].size);
+	score += static_cast<int64_t>(std::min<VkDeviceSize>(largestDeviceLocalHeap >> 30, 32)) * 50;
 
-	auto it = s_VulkanExtensionFunctions.find(cpFunctionName);
-	if (it != s_VulkanExtensionFunctions.end())
-		fFunction = it->second;
-	else
+	// Dedicated transfer and async compute families let uploads and compute overlap with graphics.
+	bool hasDedicatedTransfer = false;
+	bool hasAsyncCompute = false;
+	for (const VkQueueFamilyProperties& crQueueFamily : crQueueFamilies)
 	{
-		fFunction = vkGetInstanceProcAddr(pInstance, cpFunctionName);
-		s_VulkanExtensionFunctions[cpFunctionName] = fFunction;
+		if ((crQueueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(crQueueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			hasDedicatedTransfer = true;
+		if ((crQueueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(crQueueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+			hasAsyncCompute = true;
 	}
+	score += hasDedicatedTransfer * 100 + hasAsyncCompute * 100;
 
-	if (fFunction == nullptr)
-		return static_cast<Ret>(VK_ERROR_EXTENSION_NOT_PRESENT);
-	return static_cast<Ret>(((PFN)fFunction)(pInstance, std::forward<Args>(args)...));
+	score += static_cast<int64_t>(optionalExtensionCount) * 50;
+	return typeRank * DEVICE_TYPE_WEIGHT + std::min(score, DEVICE_TYPE_WEIGHT - 1);
 }
 
-#define vkCallFunctionEXT(func, ...) vkCallFunctionEXT_IMPL<PFN_##func, VkResult>(m_pInstance, #func __VA_OPT__(,) __VA_ARGS__)
-#define vkCallVoidFunctionEXT(func, ...) vkCallFunctionEXT_IMPL<PFN_##func, void>(m_pInstance, #func __VA_OPT__(,) __VA_ARGS__)
-
-#if !CONFIG_DIST // !ENABLE_LOGGING
-static VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessageCallback
-(
-	VkDebugUtilsMessageSeverityFlagBitsEXT severity,
-	VkDebugUtilsMessageTypeFlagsEXT type,
-	const VkDebugUtilsMessengerCallbackDataEXT* cpCallbackData,
-	void* pUserData
-)
+#if !CONFIG_DIST // ENABLE_LOGGING
+static constexpr auto VALIDATION_LAYERS = std::to_array({
+	"VK_LAYER_KHRONOS_validation"
+});
+#endif
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start)
 {
-	// VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT -> trace
-	// VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT -> info
-	// VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT -> warning
-	// VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT -> error
-	std::cerr << "Vulkan Debug: " << cpCallbackData->pMessage << '\n';
-	return VK_FALSE;
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The preferred device is either a case insensitive device UUID (dashes optional) or part of the device's name.
+static bool IsPreferredPhysicalDevice(const std::string& crPreferredDevice, const VkPhysicalDeviceProperties& crProperties, const VkPhysicalDeviceIDProperties& crIDProperties)
+{
+	if (strstr(crProperties.deviceName, crPreferredDevice.c_str()) != nullptr)
+		return true;
+
+	std::string preferredUUID;
+	for (char c : crPreferredDevice)
+		if (c != '-')
+			preferredUUID += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+	char deviceUUID[VK_UUID_SIZE * 2 + 1];
+	for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+		snprintf(deviceUUID + i * 2, 3, "%02x", crIDProperties.deviceUUID[i]);
+	return preferredUUID == deviceUUID;
 }
-#endif
 
 namespace core
 {
-	Application::Application()
+	Application::Application(const ApplicationSpecification& crSpecification)
+		: m_Headless(crSpecification.headless), m_FrameLimit(crSpecification.frameLimit),
+		m_PresentModePolicy(crSpecification.presentModePolicy), m_ReadbackCallback(crSpecification.readbackCallback),
+		m_FrameCallback(crSpecification.frameCallback)
 	{
-		// Initialize GLFW and create a window.
-		{
-			int32_t glfwInitialized = glfwInit();
-			assert(glfwInitialized && "Failed to initialize GLFW.");
+		PROFILE_FUNCTION();
+		m_StartupStatistics.Begin();
 
-			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-			glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		// Everything else may use jobs, so the job system comes first and goes last.
+		{
+			StartupPhaseScope jobSystemPhase(m_StartupStatistics, "Create Job System");
+			m_JobSystem.Create(crSpecification.jobWorkerCount);
+		}
+		m_FrameStatistics.Create(crSpecification.frameStatisticsFilepath);
+		// Before anything Vulkan, and destroyed after the instance.
+		m_HostAllocator.Create();
 
-			m_pWindow = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
-			assert(m_pWindow && "Failed to create window.");
+		// Independent startup work overlaps with everything below, and is waited on at the end.
+		JobCounter startupJobCounter;
+		for (const StartupJob& crStartupJob : crSpecification.startupJobs)
+		{
+			m_JobSystem.Schedule([this, crStartupJob]()
+			{
+				StartupPhaseScope startupJobPhase(m_StartupStatistics, crStartupJob.cpName);
+				crStartupJob.function();
+			}, &startupJobCounter);
 		}
 
 		// Setup Vulkan.
 		{
 			VkResult result = VK_SUCCESS;
 
-			// Get required extensions
-			uint32_t glfwRequiredExtensionCount;
-			const char** cppGLFWRequiredExtensions = glfwGetRequiredInstanceExtensions(&glfwRequiredExtensionCount);
-			assert(cppGLFWRequiredExtensions && "Failed to get required glfw extensions.");
-			std::vector<const char*> requiredExtensions(cppGLFWRequiredExtensions, cppGLFWRequiredExtensions + glfwRequiredExtensionCount);
+			// Get required extensions. Headless mode never touches GLFW, so it works without a display server.
+			std::vector<const char*> requiredExtensions;
+			if (!m_Headless)
+			{
+				StartupPhaseScope glfwPhase(m_StartupStatistics, "Initialize GLFW");
+
+				int32_t glfwInitialized = glfwInit();
+				assert(glfwInitialized && "Failed to initialize GLFW.");
+
+				uint32_t glfwRequiredExtensionCount;
+				const char** cppGLFWRequiredExtensions = glfwGetRequiredInstanceExtensions(&glfwRequiredExtensionCount);
+				assert(cppGLFWRequiredExtensions && "Failed to get required glfw extensions.");
+				requiredExtensions.assign(cppGLFWRequiredExtensions, cppGLFWRequiredExtensions + glfwRequiredExtensionCount);
+			}
 #if !CONFIG_DIST // ENABLE_LOGGING
 			requiredExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
 
-			// Get info.
-			VkApplicationInfo appInfo{};
-			appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-			appInfo.pApplicationName = WINDOW_TITLE;
-			appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
-			appInfo.pEngineName = "Minecraft Recoded Engine";
-			appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-			appInfo.apiVersion = VK_API_VERSION_1_3;
-
-			VkInstanceCreateInfo instanceCreateInfo{};
-			instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-			instanceCreateInfo.pApplicationInfo = &appInfo;
-			instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredExtensions.size());
-			instanceCreateInfo.ppEnabledExtensionNames = requiredExtensions.data();
-
-			// Validation Layers for debugging.
-#if !CONFIG_DIST // ENABLE_LOGGING.
-			uint32_t layerCount;
-			result = vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
-			assert(result == VK_SUCCESS && "Failed to get available layer count.");
-			std::vector<VkLayerProperties> availableLayerProperties(layerCount);
-			result = vkEnumerateInstanceLayerProperties(&layerCount, availableLayerProperties.data());
-			assert(result == VK_SUCCESS && "Failed to get available layer properties.");
-
-			constexpr auto validationLayers = std::to_array({
-				"VK_LAYER_KHRONOS_validation"
-			});
+			// Creating the instance (loading the drivers and layers) doesn't need the window, so it runs as a job while
+			// this thread creates the window, which has to happen on the main thread.
+			JobCounter instanceCounter;
+			m_JobSystem.Schedule([this, &requiredExtensions]() { CreateInstance(requiredExtensions); }, &instanceCounter);
 
-			const char* cpLayerNotFound = nullptr;
-			for (const char* cpLayerName : validationLayers)
+			if (!m_Headless)
 			{
-				bool layerFound = false;
-				for (const VkLayerProperties& crLayerProperties : availableLayerProperties)
-				{
-					if (strcmp(cpLayerName, crLayerProperties.layerName) == 0)
-					{
-						layerFound = true;
-						break;
-					}
-				}
-
-				if (!layerFound)
-				{
-					cpLayerNotFound = cpLayerName;
-					break;
-				}
-			}
+				StartupPhaseScope windowPhase(m_StartupStatistics, "Create Window");
 
-			assert(cpLayerNotFound == nullptr && "Failed to find validation layer.");
+				glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+				glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
-			instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-			instanceCreateInfo.ppEnabledLayerNames = validationLayers.data();
-#endif
+				m_pWindow = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, NULL, NULL);
+				assert(m_pWindow && "Failed to create window.");
 
-#if !CONFIG_DIST // ENABLE_LOGGING
-			// Let the debug messenger callback be used for creating and destroying the instance.
-			VkDebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo{};
-			debugMessengerCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
-			debugMessengerCreateInfo.messageSeverity = /*VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |*/
-				/*VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |*/ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
-				VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
-			debugMessengerCreateInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
-				VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-			debugMessengerCreateInfo.pfnUserCallback = DebugMessageCallback;
-
-			instanceCreateInfo.pNext = &debugMessengerCreateInfo;
-#endif
-
-			// Create the instance.
-			result = vkCreateInstance(&instanceCreateInfo, nullptr, &m_pInstance);
-			assert(result == VK_SUCCESS && "Failed to create Vulkan instance.");
+				// The swap chain is rebuilt lazily on the next frame, so resize storms only cost a flag write each.
+				glfwSetWindowUserPointer(m_pWindow, this);
+				glfwSetFramebufferSizeCallback(m_pWindow, [](GLFWwindow* pWindow, int32_t, int32_t)
+				{
+					Application* pApplication = static_cast<Application*>(glfwGetWindowUserPointer(pWindow));
+					pApplication->m_SwapChainDirty = true;
+				});
+			}
 
-#if !CONFIG_DIST // ENABLE_LOGGING
-			// Create the debug messenger.
-			result = vkCallFunctionEXT(vkCreateDebugUtilsMessengerEXT, &debugMessengerCreateInfo, nullptr, &m_pDebugMessenger);
-			assert(result == VK_SUCCESS && "Failed to create Vulkan debug messenger.");
-#endif
+			{
+				StartupPhaseScope instanceWaitPhase(m_StartupStatistics, "Wait For Instance");
+				m_JobSystem.Wait(instanceCounter);
+			}
 
 			// Create window surface for rendering to the glfw window from Vulkan.
-			result = glfwCreateWindowSurface(m_pInstance, m_pWindow, nullptr, &m_pSurface);
-			assert(result == VK_SUCCESS && "Failed to create window surface.");
+			if (!m_Headless)
+			{
+				StartupPhaseScope surfacePhase(m_StartupStatistics, "Create Surface");
+				result = glfwCreateWindowSurface(m_pInstance, m_pWindow, m_HostAllocator.GetCallbacks(), &m_pSurface);
+				assert(result == VK_SUCCESS && "Failed to create window surface.");
+			}
 
+			StartupPhaseScope physicalDevicePhase(m_StartupStatistics, "Pick Physical Device");
 			// Select a suitable physical device. (for future reference, you can use multiple physical devices simultaneously)
 			uint32_t physicalDeviceCount;
 			result = vkEnumeratePhysicalDevices(m_pInstance, &physicalDeviceCount, nullptr);
@@ -168,114 +182,141 @@ namespace core
 			result = vkEnumeratePhysicalDevices(m_pInstance, &physicalDeviceCount, physicalDevices.data());
 			assert(result == VK_SUCCESS && "Failed to get physical devices.");
 
-			constexpr auto requiredDeviceExtensions = std::to_array({
-				VK_KHR_SWAPCHAIN_EXTENSION_NAME
-			});
+			// Headless mode never presents, so it doesn't need a swap chain.
+			std::vector<const char*> requiredDeviceExtensions;
+			if (!m_Headless)
+				requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
 			struct QueueFamilyIndices
 			{
 				std::optional<uint32_t> graphics;
 				std::optional<uint32_t> present;
+				// These two are always set once graphics is, falling back to the graphics family.
+				std::optional<uint32_t> transfer;
+				std::optional<uint32_t> compute;
 
-				constexpr bool IsComplete() const noexcept
-				{
-					return graphics.has_value() && present.has_value();
-				}
-
-				std::unordered_set<uint32_t> GetUniqueIndices() const noexcept
-				{
-					assert(IsComplete() && "Tried to get unique indices for an incomplete set of queue family indices.");
-					return { graphics.value(), present.value() };
-				}
-
-				constexpr auto GetIndices() const noexcept
+				constexpr bool IsComplete(bool headless) const noexcept
 				{
-					assert(IsComplete() && "Tried to get indices for an incomplete set of queue family indices.");
-					return std::to_array({ graphics.value(), present.value() });
+					return graphics.has_value() && (headless || present.has_value());
 				}
 			};
 
+			// Optional extensions are enabled when supported, and make a device score higher.
+			constexpr auto optionalDeviceExtensions = std::to_array({
+				VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+			});
+
 			QueueFamilyIndices queueFamilyIndices;
-			VkSurfaceCapabilitiesKHR swapChainCapabilities;
-			VkSurfaceFormatKHR swapChainSurfaceFormat;
-			VkPresentModeKHR swapChainPresentMode;
-			VkExtent2D swapChainExtent;
+			std::vector<VkQueueFamilyProperties> selectedQueueFamilies;
 			{
-				VkPhysicalDeviceProperties physicalDeviceProperties;
-				VkPhysicalDeviceFeatures physicalDeviceFeatures;
+				// Every suitable device is scored and the highest score wins, unless a device was asked for by name or UUID.
+				int64_t bestScore = -1;
+				bool bestIsPreferred = false;
 				for (VkPhysicalDevice pPhysicalDevice : physicalDevices)
 				{
-					vkGetPhysicalDeviceProperties(pPhysicalDevice, &physicalDeviceProperties);
-					vkGetPhysicalDeviceFeatures(pPhysicalDevice, &physicalDeviceFeatures);
+					VkPhysicalDeviceIDProperties physicalDeviceIDProperties{};
+					physicalDeviceIDProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+					VkPhysicalDeviceProperties2 physicalDeviceProperties2{};
+					physicalDeviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+					physicalDeviceProperties2.pNext = &physicalDeviceIDProperties;
+					vkGetPhysicalDeviceProperties2(pPhysicalDevice, &physicalDeviceProperties2);
+					const VkPhysicalDeviceProperties& crPhysicalDeviceProperties = physicalDeviceProperties2.properties;
 
-					// Check if the device is a dedicated GPU.
-					if (physicalDeviceProperties.deviceType != VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-						continue;
+					VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+					vkGetPhysicalDeviceMemoryProperties(pPhysicalDevice, &physicalDeviceMemoryProperties);
 
 					// Check if the device has required queue families.
-					{
-						uint32_t queueFamilyCount;
-						vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &queueFamilyCount, nullptr);
-						std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-						vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &queueFamilyCount, queueFamilies.data());
+					uint32_t queueFamilyCount;
+					vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &queueFamilyCount, nullptr);
+					std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+					vkGetPhysicalDeviceQueueFamilyProperties(pPhysicalDevice, &queueFamilyCount, queueFamilies.data());
 
-						QueueFamilyIndices pendingQueueFamilyIndices;
-						for (uint32_t i = 0; i < queueFamilyCount && !pendingQueueFamilyIndices.IsComplete(); i++)
-						{
-							const VkQueueFamilyProperties& queueFamily = queueFamilies[i];
+					QueueFamilyIndices pendingQueueFamilyIndices;
+					for (uint32_t i = 0; i < queueFamilyCount && !pendingQueueFamilyIndices.IsComplete(m_Headless); i++)
+					{
+						const VkQueueFamilyProperties& queueFamily = queueFamilies[i];
 
-							if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
-								pendingQueueFamilyIndices.graphics = i;
+						if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
+							pendingQueueFamilyIndices.graphics = i;
 
-							VkBool32 presentSupport = VK_FALSE;
-							result = vkGetPhysicalDeviceSurfaceSupportKHR(pPhysicalDevice, i, m_pSurface, &presentSupport);
-							assert(result == VK_SUCCESS && "Failed to query present support.");
-							if (presentSupport == VK_TRUE)
-								pendingQueueFamilyIndices.present = i;
-						}
-
-						if (!pendingQueueFamilyIndices.IsComplete())
+						if (m_Headless)
 							continue;
 
-						queueFamilyIndices = pendingQueueFamilyIndices;
+						VkBool32 presentSupport = VK_FALSE;
+						result = vkGetPhysicalDeviceSurfaceSupportKHR(pPhysicalDevice, i, m_pSurface, &presentSupport);
+						assert(result == VK_SUCCESS && "Failed to query present support.");
+						if (presentSupport == VK_TRUE)
+							pendingQueueFamilyIndices.present = i;
 					}
 
-					// Check if the device has the required extensions.
+					if (!pendingQueueFamilyIndices.IsComplete(m_Headless))
+						continue;
+
+					// Prefer a transfer only family (usually a DMA engine), then any family without graphics, so uploads run
+					// alongside rendering. Every compute family supports transfers, even if it doesn't say so.
+					for (uint32_t i = 0; i < queueFamilyCount && !pendingQueueFamilyIndices.transfer.has_value(); i++)
+						if ((queueFamilies[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamilies[i].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+							pendingQueueFamilyIndices.transfer = i;
+					for (uint32_t i = 0; i < queueFamilyCount && !pendingQueueFamilyIndices.transfer.has_value(); i++)
+						if ((queueFamilies[i].queueFlags & (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT)) && !(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+							pendingQueueFamilyIndices.transfer = i;
+					if (!pendingQueueFamilyIndices.transfer.has_value())
+						pendingQueueFamilyIndices.transfer = pendingQueueFamilyIndices.graphics;
+
+					// Prefer a compute family without graphics, so compute work runs asynchronously to rendering.
+					for (uint32_t i = 0; i < queueFamilyCount && !pendingQueueFamilyIndices.compute.has_value(); i++)
+						if ((queueFamilies[i].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+							pendingQueueFamilyIndices.compute = i;
+					if (!pendingQueueFamilyIndices.compute.has_value())
+						pendingQueueFamilyIndices.compute = pendingQueueFamilyIndices.graphics;
+
+					// Timeline semaphores are how queues are synchronized with each other and with the CPU, submissions and
+					// barriers use synchronization2, and frames are rendered with dynamic rendering so secondaries don't need
+					// render pass objects.
+					if (crPhysicalDeviceProperties.apiVersion < VK_API_VERSION_1_3)
+						continue;
+
+					VkPhysicalDeviceVulkan13Features physicalDeviceVulkan13Features{};
+					physicalDeviceVulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+					VkPhysicalDeviceVulkan12Features physicalDeviceVulkan12Features{};
+					physicalDeviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+					physicalDeviceVulkan12Features.pNext = &physicalDeviceVulkan13Features;
+					VkPhysicalDeviceFeatures2 physicalDeviceFeatures2{};
+					physicalDeviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+					physicalDeviceFeatures2.pNext = &physicalDeviceVulkan12Features;
+					vkGetPhysicalDeviceFeatures2(pPhysicalDevice, &physicalDeviceFeatures2);
+					if (physicalDeviceVulkan12Features.timelineSemaphore != VK_TRUE || physicalDeviceVulkan13Features.synchronization2 != VK_TRUE ||
+						physicalDeviceVulkan13Features.dynamicRendering != VK_TRUE)
+						continue;
+
+					// Check if the device has the required extensions, and which optional ones it has.
+					uint32_t extensionCount;
+					result = vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extensionCount, nullptr);
+					assert(result == VK_SUCCESS && "Failed to get physical device extension count.");
+					std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+					result = vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+					assert(result == VK_SUCCESS && "Failed to get physical device extensions.");
+
+					auto hasExtension = [&availableExtensions](const char* cpExtension)
 					{
-						uint32_t extensionCount;
-						result = vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extensionCount, nullptr);
-						assert(result == VK_SUCCESS && "Failed to get physical device extension count.");
-						std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-						result = vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
-						assert(result == VK_SUCCESS && "Failed to get physical device extensions.");
-
-						bool hasRequiredExtensions = true;
-						for (const char* cpRequiredExtension : requiredDeviceExtensions)
-						{
-							auto it = std::find_if(availableExtensions.begin(), availableExtensions.end(),
-								[cpRequiredExtension](const VkExtensionProperties& crAvailableExtension)
-								{
-									return strcmp(crAvailableExtension.extensionName, cpRequiredExtension) == 0;
-								}
-							);
-
-							if (it == availableExtensions.end())
+						return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+							[cpExtension](const VkExtensionProperties& crAvailableExtension)
 							{
-								hasRequiredExtensions = false;
-								break;
+								return strcmp(crAvailableExtension.extensionName, cpExtension) == 0;
 							}
-						}
+						);
+					};
 
-						if (!hasRequiredExtensions)
-							continue;
-					}
+					if (!std::all_of(requiredDeviceExtensions.begin(), requiredDeviceExtensions.end(), hasExtension))
+						continue;
+
+					std::vector<const char*> pendingOptionalExtensions;
+					std::copy_if(optionalDeviceExtensions.begin(), optionalDeviceExtensions.end(), std::back_inserter(pendingOptionalExtensions), hasExtension);
 
 					// Check if the swap chain has required support.
+					VkSurfaceFormatKHR pendingSurfaceFormat{};
+					if (!m_Headless)
 					{
-						VkSurfaceCapabilitiesKHR surfaceCapabilities;
-						result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(pPhysicalDevice, m_pSurface, &surfaceCapabilities);
-						assert(result == VK_SUCCESS && "Failed to get physical device surface capabilities.");
-
 						uint32_t formatCount;
 						result = vkGetPhysicalDeviceSurfaceFormatsKHR(pPhysicalDevice, m_pSurface, &formatCount, nullptr);
 						assert(result == VK_SUCCESS && "Failed to get physical device surface format count.");
@@ -286,177 +327,216 @@ namespace core
 						uint32_t presentModeCount;
 						result = vkGetPhysicalDeviceSurfacePresentModesKHR(pPhysicalDevice, m_pSurface, &presentModeCount, nullptr);
 						assert(result == VK_SUCCESS && "Failed to get physical device surface present mode count.");
-						std::vector<VkPresentModeKHR> presentModes(presentModeCount);
-						result = vkGetPhysicalDeviceSurfacePresentModesKHR(pPhysicalDevice, m_pSurface, &presentModeCount, presentModes.data());
-						assert(result == VK_SUCCESS && "Failed to get physical device surface present modes.");
 
 						// This check won't always be the case. Certain capabilities, formats, present modes, and  may be required.
-						if (formats.empty() || presentModes.empty())
+						if (formats.empty() || presentModeCount == 0)
 							continue;
 
-						// Get swap chain info.
-
-						swapChainCapabilities = surfaceCapabilities;
+						// Get swap chain info. The capabilities and extent are queried every time the swap chain is (re)created,
+						// and the present mode is picked from the current policy every time too.
 
 						// VK_FORMAT_B8G8R8A8_SRGB and VK_COLOR_SPACE_SRGB_NONLINEAR_KHR are preferred,
 						// but if no such format exists, default to the first format.
-						swapChainSurfaceFormat = formats.front();
+						pendingSurfaceFormat = formats.front();
 						for (const VkSurfaceFormatKHR& crFormat : formats)
 						{
 							if (crFormat.format == VK_FORMAT_B8G8R8A8_SRGB && crFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR)
 							{
-								swapChainSurfaceFormat = crFormat;
+								pendingSurfaceFormat = crFormat;
 								break;
 							}
 						}
-
-						// VK_PRESENT_MODE_FIFO_KHR is always gaurenteed to exist.
-						// However, some games, Terraria for example, allow frame skipping,
-						// which I THINK is VK_PRESENT_MODE_MAILBOX_KHR.
-						swapChainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
-						//bool wantFrameSkip = false;
-						//if (wantFrameSkip)
-						//{
-						//	for (const VkPresentModeKHR& crPresentMode : presentModes)
-						//	{
-						//		if (crPresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-						//		{
-						//			presentMode = crPresentMode;
-						//			break;
-						//		}
-						//	}
-						//}
-						//if (wantFrameSkip && presentMode != VK_PRESENT_MODE_MAILBOX_KHR)
-						//	; // warn: could not enable frame skip.
-
-						swapChainExtent = surfaceCapabilities.currentExtent;
-						if (swapChainExtent.width == UINT32_MAX || swapChainExtent.height == UINT32_MAX)
-						{
-							glfwGetFramebufferSize(m_pWindow, (int32_t*)(&swapChainExtent.width), (int32_t*)(&swapChainExtent.height));
-							swapChainExtent.width = std::clamp(swapChainExtent.width, surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width);
-							swapChainExtent.height = std::clamp(swapChainExtent.height, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height);
-						}
 					}
 
+					// The device is suitable, see if it's better than the best one so far.
+					int64_t score = ScorePhysicalDevice(crPhysicalDeviceProperties, physicalDeviceMemoryProperties, queueFamilies, pendingOptionalExtensions.size());
+					bool isPreferred = !crSpecification.preferredDevice.empty() &&
+						IsPreferredPhysicalDevice(crSpecification.preferredDevice, crPhysicalDeviceProperties, physicalDeviceIDProperties);
+
+#if !CONFIG_DIST // ENABLE_LOGGING
+					std::cerr << "Physical device \"" << crPhysicalDeviceProperties.deviceName << "\" scored " << score << (isPreferred ? " (preferred)" : "") << ".\n";
+#endif
+
+					if (isPreferred < bestIsPreferred || (isPreferred == bestIsPreferred && score <= bestScore))
+						continue;
+
+					bestScore = score;
+					bestIsPreferred = isPreferred;
 					m_pPhysicalDevice = pPhysicalDevice;
-					break;
+					m_PhysicalDeviceProperties = crPhysicalDeviceProperties;
+					queueFamilyIndices = pendingQueueFamilyIndices;
+					selectedQueueFamilies = std::move(queueFamilies);
+					m_SwapChainSurfaceFormat = pendingSurfaceFormat;
+					m_EnabledOptionalDeviceExtensions = std::move(pendingOptionalExtensions);
 				}
 
 				assert(m_pPhysicalDevice != VK_NULL_HANDLE && "Failed to find suitable physical device.");
+#if !CONFIG_DIST // ENABLE_LOGGING
+				if (!crSpecification.preferredDevice.empty() && !bestIsPreferred)
+					std::cerr << "Preferred physical device \"" << crSpecification.preferredDevice << "\" not found or not suitable, using the highest scoring one instead.\n";
+#endif
 			}
 
+			physicalDevicePhase.End();
+
+			// Reading the pipeline cache file only needs the device's properties, so it overlaps with device creation.
+			// Creating the cache from it needs the device, so that's a job that depends on the read.
+			JobCounter pipelineCacheLoadCounter;
+			m_JobSystem.Schedule([this]()
+			{
+				StartupPhaseScope pipelineCacheLoadPhase(m_StartupStatistics, "Load Pipeline Cache");
+				m_PipelineCache.Load(m_PhysicalDeviceProperties, PIPELINE_CACHE_DIRECTORY);
+			}, &pipelineCacheLoadCounter);
+
 			// Create the logical device.
 			{
+				StartupPhaseScope devicePhase(m_StartupStatistics, "Create Device");
+
+				// Transfer and compute get their own queue when their family has one to spare, since a queue can't be
+				// submitted to from multiple threads at once. Present shares the graphics queue when it can.
+				std::unordered_map<uint32_t, uint32_t> queueCounts;
+				auto requestQueue = [&queueCounts, &selectedQueueFamilies](uint32_t queueFamilyIndex)
+				{
+					uint32_t& rQueueCount = queueCounts[queueFamilyIndex];
+					uint32_t queueIndex = std::min(rQueueCount, selectedQueueFamilies[queueFamilyIndex].queueCount - 1);
+					rQueueCount = queueIndex + 1;
+					return queueIndex;
+				};
+
+				uint32_t graphicsQueueIndex = requestQueue(queueFamilyIndices.graphics.value());
+				uint32_t presentQueueIndex = 0;
+				if (!m_Headless)
+					presentQueueIndex = queueFamilyIndices.present == queueFamilyIndices.graphics ? graphicsQueueIndex : requestQueue(queueFamilyIndices.present.value());
+				uint32_t transferQueueIndex = requestQueue(queueFamilyIndices.transfer.value());
+				uint32_t computeQueueIndex = requestQueue(queueFamilyIndices.compute.value());
+
 				// Create device queue infos.
-				constexpr float queuePriority = 1.0f;
+				uint32_t maxQueueCount = 0;
+				for (auto [queueFamilyIndex, queueCount] : queueCounts)
+					maxQueueCount = std::max(maxQueueCount, queueCount);
+				std::vector<float> queuePriorities(maxQueueCount, 1.0f);
+
 				std::vector<VkDeviceQueueCreateInfo> deviceQueueCreateInfos;
-				std::unordered_set<uint32_t> uniqueQueueFamilyIndices = queueFamilyIndices.GetUniqueIndices();
-				for (uint32_t queueFamilyIndex : uniqueQueueFamilyIndices)
+				for (auto [queueFamilyIndex, queueCount] : queueCounts)
 				{
 					VkDeviceQueueCreateInfo deviceQueueCreateInfo{};
 					deviceQueueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 					deviceQueueCreateInfo.queueFamilyIndex = queueFamilyIndex;
-					deviceQueueCreateInfo.queueCount = 1;
-					deviceQueueCreateInfo.pQueuePriorities = &queuePriority;
+					deviceQueueCreateInfo.queueCount = queueCount;
+					deviceQueueCreateInfo.pQueuePriorities = queuePriorities.data();
 					deviceQueueCreateInfos.push_back(deviceQueueCreateInfo);
 				}
 
 				VkPhysicalDeviceFeatures deviceFeatures{};
 
+				VkPhysicalDeviceVulkan13Features deviceVulkan13Features{};
+				deviceVulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+				deviceVulkan13Features.synchronization2 = VK_TRUE;
+				deviceVulkan13Features.dynamicRendering = VK_TRUE;
+
+				VkPhysicalDeviceVulkan12Features deviceVulkan12Features{};
+				deviceVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+				deviceVulkan12Features.pNext = &deviceVulkan13Features;
+				deviceVulkan12Features.timelineSemaphore = VK_TRUE;
+
 				// Create the logical device info.
 				VkDeviceCreateInfo deviceCreateInfo{};
 				deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+				deviceCreateInfo.pNext = &deviceVulkan12Features;
 				deviceCreateInfo.pQueueCreateInfos = deviceQueueCreateInfos.data();
 				deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(deviceQueueCreateInfos.size());
-				deviceCreateInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
-				deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
+				std::vector<const char*> enabledDeviceExtensions = requiredDeviceExtensions;
+				enabledDeviceExtensions.insert(enabledDeviceExtensions.end(), m_EnabledOptionalDeviceExtensions.begin(), m_EnabledOptionalDeviceExtensions.end());
+				deviceCreateInfo.ppEnabledExtensionNames = enabledDeviceExtensions.data();
+				deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledDeviceExtensions.size());
 				deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
 #if !CONFIG_DIST // ENABLE_LOGGING.
 				// These two are only for backwards compatability. They are ignored by newer versions of Vulkan.
-				deviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-				deviceCreateInfo.ppEnabledLayerNames = validationLayers.data();
+				deviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
+				deviceCreateInfo.ppEnabledLayerNames = VALIDATION_LAYERS.data();
 #endif
 
-				result = vkCreateDevice(m_pPhysicalDevice, &deviceCreateInfo, nullptr, &m_pDevice);
+				result = vkCreateDevice(m_pPhysicalDevice, &deviceCreateInfo, m_HostAllocator.GetCallbacks(), &m_pDevice);
 				assert(result == VK_SUCCESS && "Failed to create logical device.");
 
-				// Get device queue handles.
-				vkGetDeviceQueue(m_pDevice, queueFamilyIndices.graphics.value(), 0, &m_pGraphicsQueue);
-				vkGetDeviceQueue(m_pDevice, queueFamilyIndices.present.value(), 0, &m_pPresentQueue);
-			}
+				m_DeviceDispatch.Load(m_pDevice, m_HostAllocator.GetCallbacks());
 
-			// Create swap chain.
-			{
-				// Get the image count.
-				uint32_t imageCount = swapChainCapabilities.minImageCount + 1;
-				if (swapChainCapabilities.maxImageCount > 0 && imageCount > swapChainCapabilities.maxImageCount)
-					imageCount = swapChainCapabilities.maxImageCount;
-
-				VkSwapchainCreateInfoKHR swapChainCreateInfo{};
-				swapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-				swapChainCreateInfo.surface = m_pSurface;
-				swapChainCreateInfo.minImageCount = imageCount;
-				swapChainCreateInfo.imageFormat = swapChainSurfaceFormat.format;
-				swapChainCreateInfo.imageColorSpace = swapChainSurfaceFormat.colorSpace;
-				swapChainCreateInfo.imageExtent = swapChainExtent;
-				swapChainCreateInfo.imageArrayLayers = 1;
-				swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-
-				auto indices = queueFamilyIndices.GetIndices();
-				if (queueFamilyIndices.graphics != queueFamilyIndices.present)
+				// Get device queue handles.
+				m_DeviceDispatch.vkGetDeviceQueue(m_pDevice, queueFamilyIndices.graphics.value(), graphicsQueueIndex, &m_pGraphicsQueue);
+				m_GraphicsQueueFamilyIndex = queueFamilyIndices.graphics.value();
+				if (!m_Headless)
+				{
+					m_DeviceDispatch.vkGetDeviceQueue(m_pDevice, queueFamilyIndices.present.value(), presentQueueIndex, &m_pPresentQueue);
+					m_PresentQueueFamilyIndex = queueFamilyIndices.present.value();
+				}
+				m_DeviceDispatch.vkGetDeviceQueue(m_pDevice, queueFamilyIndices.transfer.value(), transferQueueIndex, &m_pTransferQueue);
+				m_TransferQueueFamilyIndex = queueFamilyIndices.transfer.value();
+				m_DeviceDispatch.vkGetDeviceQueue(m_pDevice, queueFamilyIndices.compute.value(), computeQueueIndex, &m_pComputeQueue);
+				m_ComputeQueueFamilyIndex = queueFamilyIndices.compute.value();
+
+				// Every queue gets one batcher no matter how many roles share it, and nothing is added after this,
+				// so looking them up later is thread safe.
+				auto getBatcher = [this](VkQueue pQueue) -> rendering::SubmitBatcher&
+				{
+					rendering::SubmitBatcher& rBatcher = m_SubmitBatchers[pQueue];
+					if (rBatcher.GetQueue() == VK_NULL_HANDLE)
+						rBatcher.Create(m_DeviceDispatch, pQueue);
+					return rBatcher;
+				};
+				m_GraphicsTimeline.Create(m_pDevice, m_DeviceDispatch, getBatcher(m_pGraphicsQueue), m_GraphicsQueueFamilyIndex);
+				m_TransferTimeline.Create(m_pDevice, m_DeviceDispatch, getBatcher(m_pTransferQueue), m_TransferQueueFamilyIndex);
+				m_ComputeTimeline.Create(m_pDevice, m_DeviceDispatch, getBatcher(m_pComputeQueue), m_ComputeQueueFamilyIndex);
+				if (!m_Headless)
+					m_pPresentBatcher = &getBatcher(m_pPresentQueue);
+
+				// Compute may wait on uploads, frames wait on both, and presenting waits on the frame.
+				rendering::SubmitBatcher& rGraphicsBatcher = m_GraphicsTimeline.GetBatcher();
+				rendering::SubmitBatcher& rTransferBatcher = m_TransferTimeline.GetBatcher();
+				rendering::SubmitBatcher& rComputeBatcher = m_ComputeTimeline.GetBatcher();
+				rComputeBatcher.AddDependency(rTransferBatcher);
+				rGraphicsBatcher.AddDependency(rTransferBatcher);
+				rGraphicsBatcher.AddDependency(rComputeBatcher);
+				if (m_pPresentBatcher)
 				{
-					swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-					swapChainCreateInfo.queueFamilyIndexCount = 2;
-					swapChainCreateInfo.pQueueFamilyIndices = indices.data();
+					m_pPresentBatcher->AddDependency(rTransferBatcher);
+					m_pPresentBatcher->AddDependency(rComputeBatcher);
+					m_pPresentBatcher->AddDependency(rGraphicsBatcher);
 				}
-				else
-					swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-				swapChainCreateInfo.preTransform = swapChainCapabilities.currentTransform;
-				swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-				swapChainCreateInfo.presentMode = swapChainPresentMode;
-				swapChainCreateInfo.clipped = VK_TRUE;
-				swapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
-
-				result = vkCreateSwapchainKHR(m_pDevice, &swapChainCreateInfo, nullptr, &m_pSwapChain);
-				assert(result == VK_SUCCESS && "Failed to create swap chain.");
-
-				m_SwapChainFormat = swapChainSurfaceFormat.format;
-				m_SwapChainExtent = swapChainExtent;
-
-				// Get swap chain image handles.
-				uint32_t swapChainImageCount;
-				result = vkGetSwapchainImagesKHR(m_pDevice, m_pSwapChain, &swapChainImageCount, nullptr);
-				assert(result == VK_SUCCESS && "Failed to get swap chain image count.");
-				m_SwapChainImages.resize(swapChainImageCount);
-				result = vkGetSwapchainImagesKHR(m_pDevice, m_pSwapChain, &swapChainImageCount, m_SwapChainImages.data());
-				assert(result == VK_SUCCESS && "Failed to get swap chain images.");
+
+				vkGetPhysicalDeviceMemoryProperties(m_pPhysicalDevice, &m_MemoryProperties);
 			}
 
-			// Create swap chain image views
+			JobCounter pipelineCacheCreateCounter;
+			m_JobSystem.Schedule([this]()
 			{
-				VkImageViewCreateInfo imageViewCreateInfo{};
-				imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-				imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-				imageViewCreateInfo.format = swapChainSurfaceFormat.format;
-				imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-				imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-				imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-				imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-				imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-				imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-				imageViewCreateInfo.subresourceRange.levelCount = 1;
-				imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
-				imageViewCreateInfo.subresourceRange.layerCount = 1;
-
-				m_SwapChainImageViews.resize(m_SwapChainImages.size());
-				for (size_t i = 0; i < m_SwapChainImages.size(); i++)
-				{
-					imageViewCreateInfo.image = m_SwapChainImages[i];
-					result = vkCreateImageView(m_pDevice, &imageViewCreateInfo, nullptr, &m_SwapChainImageViews[i]);
-					assert(result == VK_SUCCESS && "Failed to create swap chain image view.");
-				}
+				StartupPhaseScope pipelineCacheCreatePhase(m_StartupStatistics, "Create Pipeline Cache");
+				m_PipelineCache.Create(m_pDevice, m_DeviceDispatch);
+			}, pipelineCacheLoadCounter, &pipelineCacheCreateCounter);
+
+			StartupPhaseScope subsystemPhase(m_StartupStatistics, "Create Device Subsystems");
+			// Every buffer and image gets its memory from the allocator, instead of its own vkAllocateMemory.
+			m_DeviceAllocator.Create(m_pDevice, m_DeviceDispatch, m_PhysicalDeviceProperties, m_MemoryProperties);
+			m_DeletionQueue.Create(m_pDevice, m_DeviceDispatch, m_DeviceAllocator);
+
+			// Create the upload service. It has its own queue when the device has a separate transfer family.
+			m_UploadService.Create(m_pDevice, m_DeviceDispatch, m_DeviceAllocator, m_TransferTimeline, UPLOAD_STAGING_CAPACITY);
+			m_ComputeQueue.Create(m_pDevice, m_DeviceDispatch, m_ComputeTimeline);
+
+			subsystemPhase.End();
+
+			// Create swap chain and its image views, or the offscreen images that replace them.
+			if (m_Headless)
+			{
+				StartupPhaseScope offscreenTargetPhase(m_StartupStatistics, "Create Offscreen Targets");
+				CreateOffscreenTargets(crSpecification.headlessExtent);
+			}
+			else
+			{
+				StartupPhaseScope swapChainPhase(m_StartupStatistics, "Create Swap Chain");
+				// Launching minimized gives the surface a zero extent, so DrawFrame() keeps retrying until it's restored.
+				if (!CreateSwapChain())
+					m_SwapChainDirty = true;
 			}
 
 			// Create graphics pipeline.
@@ -465,30 +545,814 @@ namespace core
 				// https://github.com/Shlayne/MinecraftRecoded
 				// https://github.com/TheCherno/Walnut/blob/master/Walnut/src/Walnut/Application.cpp
 			}
+
+			// Create per-frame command pools and sync objects.
+			{
+				StartupPhaseScope frameObjectPhase(m_StartupStatistics, "Create Frame Objects");
+
+				VkCommandPoolCreateInfo commandPoolCreateInfo{};
+				commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+				// Each pool is reset as a whole once its frame's submission is done.
+				commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+				commandPoolCreateInfo.queueFamilyIndex = m_GraphicsQueueFamilyIndex;
+
+				VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+				commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				commandBufferAllocateInfo.commandBufferCount = 1;
+
+				VkSemaphoreCreateInfo semaphoreCreateInfo{};
+				semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+				for (FrameData& rFrame : m_Frames)
+				{
+					result = m_DeviceDispatch.vkCreateCommandPool(m_pDevice, &commandPoolCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &rFrame.pCommandPool);
+					assert(result == VK_SUCCESS && "Failed to create frame command pool.");
+
+					commandBufferAllocateInfo.commandPool = rFrame.pCommandPool;
+					result = m_DeviceDispatch.vkAllocateCommandBuffers(m_pDevice, &commandBufferAllocateInfo, &rFrame.pCommandBuffer);
+					assert(result == VK_SUCCESS && "Failed to allocate frame command buffer.");
+
+					result = m_DeviceDispatch.vkCreateSemaphore(m_pDevice, &semaphoreCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &rFrame.pImageAvailableSemaphore);
+					assert(result == VK_SUCCESS && "Failed to create image available semaphore.");
+				}
+
+				// Secondaries are recorded as jobs, each job system thread with its own pool per frame.
+				m_CommandRecorder.Create(m_pDevice, m_DeviceDispatch, m_GraphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT, m_JobSystem);
+				m_RenderGraph.Create(m_pDevice, m_DeviceDispatch, m_DeviceAllocator, m_DeletionQueue);
+
+				m_GpuProfiler.Create(m_pDevice, m_DeviceDispatch, m_PhysicalDeviceProperties.limits.timestampPeriod,
+					selectedQueueFamilies[m_GraphicsQueueFamilyIndex].timestampValidBits, MAX_FRAMES_IN_FLIGHT);
+			}
+
+			// Every pipeline is created with the pipeline cache, so it has to be done before the first frame.
+			StartupPhaseScope startupJobWaitPhase(m_StartupStatistics, "Wait For Startup Jobs");
+			m_JobSystem.Wait(pipelineCacheLoadCounter);
+			m_JobSystem.Wait(pipelineCacheCreateCounter);
+			m_JobSystem.Wait(startupJobCounter);
 		}
 	}
 
 	Application::~Application()
 	{
-		for (VkImageView pImageView : m_SwapChainImageViews)
-			vkDestroyImageView(m_pDevice, pImageView, nullptr);
-		vkDestroySwapchainKHR(m_pDevice, m_pSwapChain, nullptr);
-		vkDestroyDevice(m_pDevice, nullptr);
-		vkDestroySurfaceKHR(m_pInstance, m_pSurface, nullptr);
+		m_GpuProfiler.Destroy();
+		m_RenderGraph.Destroy();
+		m_CommandRecorder.Destroy();
+		for (FrameData& rFrame : m_Frames)
+		{
+			m_DeviceDispatch.vkDestroySemaphore(m_pDevice, rFrame.pImageAvailableSemaphore, m_DeviceDispatch.cpAllocationCallbacks);
+			m_DeviceDispatch.vkDestroyCommandPool(m_pDevice, rFrame.pCommandPool, m_DeviceDispatch.cpAllocationCallbacks);
+		}
+		m_DeletionQueue.Destroy();
+		if (m_Headless)
+			DestroyOffscreenTargets();
+		else
+			DestroySwapChain(m_pSwapChain, m_SwapChainImageViews, m_SwapChainRenderFinishedSemaphores);
+		m_ComputeQueue.Destroy();
+		m_UploadService.Destroy();
+		m_ComputeTimeline.Destroy();
+		m_TransferTimeline.Destroy();
+		m_GraphicsTimeline.Destroy();
+		for (auto& [pQueue, rBatcher] : m_SubmitBatchers)
+			rBatcher.Destroy();
+		m_PipelineCache.Save();
+		m_PipelineCache.Destroy();
+		m_DeviceAllocator.Destroy();
+		m_DeviceDispatch.vkDestroyDevice(m_pDevice, m_DeviceDispatch.cpAllocationCallbacks);
+		if (!m_Headless)
+			vkDestroySurfaceKHR(m_pInstance, m_pSurface, m_HostAllocator.GetCallbacks());
+#if !CONFIG_DIST // ENABLE_LOGGING
+		m_InstanceDispatch.vkDestroyDebugUtilsMessengerEXT(m_pInstance, m_pDebugMessenger, m_HostAllocator.GetCallbacks());
+#endif
+		vkDestroyInstance(m_pInstance, m_HostAllocator.GetCallbacks());
 #if !CONFIG_DIST // ENABLE_LOGGING
-		vkCallVoidFunctionEXT(vkDestroyDebugUtilsMessengerEXT, m_pDebugMessenger, nullptr);
+		m_DebugMessageSink.Destroy();
 #endif
-		vkDestroyInstance(m_pInstance, nullptr);
+		m_HostAllocator.Destroy();
 
-		glfwDestroyWindow(m_pWindow);
-		glfwTerminate();
+		if (!m_Headless)
+		{
+			glfwDestroyWindow(m_pWindow);
+			glfwTerminate();
+		}
+
+		m_FrameStatistics.Destroy();
+		m_JobSystem.Destroy();
+	}
+
+	void Application::CreateInstance(const std::vector<const char*>& crRequiredExtensions)
+	{
+		StartupPhaseScope instancePhase(m_StartupStatistics, "Create Instance");
+
+		VkResult result = VK_SUCCESS;
+
+		// Get info.
+		VkApplicationInfo appInfo{};
+		appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		appInfo.pApplicationName = WINDOW_TITLE;
+		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.pEngineName = "Minecraft Recoded Engine";
+		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+		appInfo.apiVersion = VK_API_VERSION_1_3;
+
+		VkInstanceCreateInfo instanceCreateInfo{};
+		instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		instanceCreateInfo.pApplicationInfo = &appInfo;
+		instanceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(crRequiredExtensions.size());
+		instanceCreateInfo.ppEnabledExtensionNames = crRequiredExtensions.data();
+
+		// Validation Layers for debugging.
+#if !CONFIG_DIST // ENABLE_LOGGING.
+		uint32_t layerCount;
+		result = vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+		assert(result == VK_SUCCESS && "Failed to get available layer count.");
+		std::vector<VkLayerProperties> availableLayerProperties(layerCount);
+		result = vkEnumerateInstanceLayerProperties(&layerCount, availableLayerProperties.data());
+		assert(result == VK_SUCCESS && "Failed to get available layer properties.");
+
+		const char* cpLayerNotFound = nullptr;
+		for (const char* cpLayerName : VALIDATION_LAYERS)
+		{
+			bool layerFound = false;
+			for (const VkLayerProperties& crLayerProperties : availableLayerProperties)
+			{
+				if (strcmp(cpLayerName, crLayerProperties.layerName) == 0)
+				{
+					layerFound = true;
+					break;
+				}
+			}
+
+			if (!layerFound)
+			{
+				cpLayerNotFound = cpLayerName;
+				break;
+			}
+		}
+
+		assert(cpLayerNotFound == nullptr && "Failed to find validation layer.");
+
+		instanceCreateInfo.enabledLayerCount = static_cast<uint32_t>(VALIDATION_LAYERS.size());
+		instanceCreateInfo.ppEnabledLayerNames = VALIDATION_LAYERS.data();
+#endif
+
+#if !CONFIG_DIST // ENABLE_LOGGING
+		// Let the debug messenger callback be used for creating and destroying the instance.
+		VkDebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo{};
+		debugMessengerCreateInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
+		debugMessengerCreateInfo.messageSeverity = /*VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT |*/
+			/*VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT |*/ VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+		debugMessengerCreateInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT |
+			VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+		debugMessengerCreateInfo.pfnUserCallback = rendering::DebugMessageSink::Callback;
+		debugMessengerCreateInfo.pUserData = &m_DebugMessageSink;
+		m_DebugMessageSink.Create();
+
+		instanceCreateInfo.pNext = &debugMessengerCreateInfo;
+#endif
+
+		// Create the instance.
+		result = vkCreateInstance(&instanceCreateInfo, m_HostAllocator.GetCallbacks(), &m_pInstance);
+		assert(result == VK_SUCCESS && "Failed to create Vulkan instance.");
+		m_InstanceDispatch.Load(m_pInstance);
+
+#if !CONFIG_DIST // ENABLE_LOGGING
+		// Create the debug messenger.
+		result = m_InstanceDispatch.vkCreateDebugUtilsMessengerEXT(m_pInstance, &debugMessengerCreateInfo, m_HostAllocator.GetCallbacks(), &m_pDebugMessenger);
+		assert(result == VK_SUCCESS && "Failed to create Vulkan debug messenger.");
+#endif
 	}
 
 	void Application::Run()
 	{
-		while (!glfwWindowShouldClose(m_pWindow))
+		// CPU frame time is measured from the end of one frame to the end of the next, so it includes everything.
+		std::chrono::steady_clock::time_point lastFrameEndTime;
+		bool hasLastFrame = false;
+
+		m_Running = true;
+		while (m_Running)
+		{
+			PROFILE_SCOPE("Frame");
+
+			if (m_FrameLimit != 0 && m_FrameNumber >= m_FrameLimit)
+				break;
+
+			if (!m_Headless)
+			{
+				{
+					PROFILE_SCOPE("Poll Events");
+					glfwPollEvents();
+				}
+				if (glfwWindowShouldClose(m_pWindow))
+					break;
+
+				// Don't render anything while minimized, just sleep until something happens.
+				int32_t framebufferWidth, framebufferHeight;
+				glfwGetFramebufferSize(m_pWindow, &framebufferWidth, &framebufferHeight);
+				if (framebufferWidth == 0 || framebufferHeight == 0)
+				{
+					glfwWaitEvents();
+					hasLastFrame = false; // Time spent minimized isn't a slow frame.
+					continue;
+				}
+			}
+
+			uint64_t frameNumber = m_FrameNumber;
+			m_FrameStatistics.BeginFrame(frameNumber);
+			if (m_FrameCallback)
+			{
+				PROFILE_SCOPE("Frame Callback");
+				m_FrameCallback(frameNumber);
+			}
+			DrawFrame();
+
+			// Nothing was submitted if the swap chain had to be rebuilt first.
+			if (m_FrameNumber != frameNumber)
+			{
+				auto frameEndTime = std::chrono::steady_clock::now();
+				if (hasLastFrame)
+					m_FrameStatistics.Record(FrameMetric::CpuFrameTime, std::chrono::duration<double, std::milli>(frameEndTime - lastFrameEndTime).count());
+				else if (frameNumber == 0)
+				{
+					m_StartupStatistics.RecordFirstFrame();
+#if !CONFIG_DIST // ENABLE_LOGGING
+					m_StartupStatistics.Print(std::cerr);
+#endif
+				}
+				lastFrameEndTime = frameEndTime;
+				hasLastFrame = true;
+				m_FrameStatistics.EndFrame();
+			}
+		}
+		m_Running = false;
+
+#if !CONFIG_DIST // ENABLE_LOGGING
+		m_FrameStatistics.PrintSessionSummary(std::cerr);
+		rendering::HostAllocator::PrintStatistics(std::cerr, m_HostAllocator.GetStatistics());
+		rendering::RenderGraph::PrintTransientMemoryStatistics(std::cerr, m_RenderGraph.GetTransientMemoryStatistics());
+#endif
+
+		// Let every frame in flight finish before anything gets destroyed.
+		PROFILE_SCOPE("Wait Device Idle");
+		VkResult result = m_DeviceDispatch.vkDeviceWaitIdle(m_pDevice);
+		assert(result == VK_SUCCESS && "Failed to wait for device idle.");
+
+		// The last frames' readbacks are only consumed when their slot comes around again, which it won't anymore.
+		if (m_Headless)
+			for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+				ConsumeReadback(m_OffscreenTargets[(m_FrameIndex + i) % MAX_FRAMES_IN_FLIGHT]);
+	}
+
+	void Application::Close()
+	{
+		m_Running = false;
+	}
+
+	void Application::SetPresentModePolicy(PresentModePolicy policy)
+	{
+		if (m_PresentModePolicy == policy)
+			return;
+
+		// The present mode is baked into the swap chain, so changing it means rebuilding it on the next frame.
+		m_PresentModePolicy = policy;
+		m_SwapChainDirty = true;
+	}
+
+	void Application::AddFrameWait(const rendering::TimelineWait& crWait)
+	{
+		// Waiting on an earlier value of a semaphore that's already being waited on is redundant.
+		for (rendering::TimelineWait& rWait : m_FrameWaits)
+		{
+			if (rWait.pSemaphore == crWait.pSemaphore)
+			{
+				rWait.value = std::max(rWait.value, crWait.value);
+				rWait.stageMask |= crWait.stageMask;
+				return;
+			}
+		}
+		m_FrameWaits.push_back(crWait);
+	}
+
+	void Application::AddRenderTask(rendering::ParallelCommandRecorder::RecordFunction task)
+	{
+		m_RenderTasks.push_back(std::move(task));
+	}
+
+	void Application::AddRenderGraphCallback(RenderGraphCallback callback)
+	{
+		m_RenderGraphCallbacks.push_back(std::move(callback));
+	}
+
+	void Application::DrawFrame()
+	{
+		PROFILE_FUNCTION();
+
+		FrameData& rFrame = m_Frames[m_FrameIndex];
+		VkResult result = VK_SUCCESS;
+
+		PROFILE_BEGIN(frameWaitScope, "Wait For Frame");
+		// Wait until the GPU is done with this frame's resources. The other frames in flight keep the GPU busy meanwhile.
+		auto frameWaitStartTime = std::chrono::steady_clock::now();
+		m_GraphicsTimeline.Wait(rFrame.timelineValue);
+		m_FrameStatistics.Record(FrameMetric::FrameWait, MillisecondsSince(frameWaitStartTime));
+		PROFILE_END(frameWaitScope);
+
+		// Destroy whatever the GPU is done with, without waiting on anything.
+		m_DeletionQueue.Collect();
+
+		// In headless mode, the image index is the frame index, since every frame in flight has its own offscreen image.
+		uint32_t imageIndex = m_FrameIndex;
+		if (m_Headless)
+			ConsumeReadback(m_OffscreenTargets[imageIndex]);
+		else
+		{
+			if (m_SwapChainDirty && !CreateSwapChain())
+				return; // The surface has a zero extent, so there's nothing to render to.
+
+			PROFILE_BEGIN(acquireScope, "Acquire Image");
+			auto acquireStartTime = std::chrono::steady_clock::now();
+			result = m_DeviceDispatch.vkAcquireNextImageKHR(m_pDevice, m_pSwapChain, UINT64_MAX, rFrame.pImageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+			m_FrameStatistics.Record(FrameMetric::AcquireWait, MillisecondsSince(acquireStartTime));
+			PROFILE_END(acquireScope);
+			if (result == VK_ERROR_OUT_OF_DATE_KHR)
+			{
+				// Nothing was signaled, so this frame can just be retried with a new swap chain.
+				m_SwapChainDirty = true;
+				return;
+			}
+			assert((result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) && "Failed to acquire swap chain image.");
+			// A suboptimal image was still acquired and its semaphore will be signaled, so it must be presented first.
+			if (result == VK_SUBOPTIMAL_KHR)
+				m_SwapChainDirty = true;
+		}
+
+		result = m_DeviceDispatch.vkResetCommandPool(m_pDevice, rFrame.pCommandPool, 0);
+		assert(result == VK_SUCCESS && "Failed to reset frame command pool.");
+		m_CommandRecorder.BeginFrame(m_FrameIndex);
+
+		RecordFrame(rFrame.pCommandBuffer, imageIndex);
+		if (uint64_t gpuFrameNanoseconds = m_GpuProfiler.GetFrameNanoseconds())
+			m_FrameStatistics.Record(FrameMetric::GpuFrameTime, static_cast<double>(gpuFrameNanoseconds) / 1'000'000.0);
+
+		PROFILE_BEGIN(uploadScope, "Flush Uploads");
+		// Submit whatever was uploaded since the last frame, and have this frame wait on it on the GPU instead of the CPU.
+		m_UploadService.Flush();
+		uint64_t uploadValue = m_UploadService.GetLastSubmittedValue();
+		if (uploadValue > m_WaitedUploadValue)
+		{
+			AddFrameWait({ m_UploadService.GetTimelineSemaphore(), uploadValue, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT });
+			m_WaitedUploadValue = uploadValue;
+		}
+		PROFILE_END(uploadScope);
+
+		std::vector<VkSemaphoreSubmitInfo> waitInfos;
+		if (!m_Headless)
 		{
-			glfwPollEvents();
+			VkSemaphoreSubmitInfo& rImageAvailableWait = waitInfos.emplace_back();
+			rImageAvailableWait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+			rImageAvailableWait.semaphore = rFrame.pImageAvailableSemaphore;
+			rImageAvailableWait.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
 		}
+		for (const rendering::TimelineWait& crWait : m_FrameWaits)
+			waitInfos.push_back(rendering::QueueTimeline::GetWaitInfo(crWait));
+		m_FrameWaits.clear();
+
+		VkSemaphoreSubmitInfo renderFinishedSignal{};
+		renderFinishedSignal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		if (!m_Headless)
+			renderFinishedSignal.semaphore = m_SwapChainRenderFinishedSemaphores[imageIndex];
+		renderFinishedSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		std::span<const VkSemaphoreSubmitInfo> signalInfos;
+		if (!m_Headless)
+			signalInfos = { &renderFinishedSignal, 1 };
+
+		VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
+		commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferSubmitInfo.commandBuffer = rFrame.pCommandBuffer;
+
+		m_GpuProfiler.EndFrame();
+		PROFILE_BEGIN(submitScope, "Submit");
+		rFrame.timelineValue = m_GraphicsTimeline.Enqueue({ &commandBufferSubmitInfo, 1 }, waitInfos, signalInfos);
+		FlushSubmissions();
+		PROFILE_END(submitScope);
+
+		if (m_Headless)
+		{
+			m_OffscreenTargets[imageIndex].readbackPending = static_cast<bool>(m_ReadbackCallback);
+			m_FrameIndex = (m_FrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+			m_FrameNumber++;
+			return;
+		}
+
+		VkPresentInfoKHR presentInfo{};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &m_SwapChainRenderFinishedSemaphores[imageIndex];
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = &m_pSwapChain;
+		presentInfo.pImageIndices = &imageIndex;
+
+		PROFILE_BEGIN(presentScope, "Present");
+		auto presentStartTime = std::chrono::steady_clock::now();
+		result = m_pPresentBatcher->Present(presentInfo);
+		m_FrameStatistics.Record(FrameMetric::PresentWait, MillisecondsSince(presentStartTime));
+		PROFILE_END(presentScope);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+			m_SwapChainDirty = true;
+		else
+			assert(result == VK_SUCCESS && "Failed to present swap chain image.");
+
+		m_FrameIndex = (m_FrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+		m_FrameNumber++;
+	}
+
+	void Application::FlushSubmissions()
+	{
+		// The graphics batcher flushes the transfer and compute batchers it depends on first. Every batcher is one
+		// vkQueueSubmit2, however many timelines share its queue.
+		m_GraphicsTimeline.GetBatcher().Flush();
+	}
+
+	bool Application::CreateSwapChain()
+	{
+		PROFILE_FUNCTION();
+
+		VkSurfaceCapabilitiesKHR surfaceCapabilities;
+		VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_pPhysicalDevice, m_pSurface, &surfaceCapabilities);
+		assert(result == VK_SUCCESS && "Failed to get physical device surface capabilities.");
+
+		VkExtent2D swapChainExtent = surfaceCapabilities.currentExtent;
+		if (swapChainExtent.width == UINT32_MAX || swapChainExtent.height == UINT32_MAX)
+		{
+			glfwGetFramebufferSize(m_pWindow, (int32_t*)(&swapChainExtent.width), (int32_t*)(&swapChainExtent.height));
+			swapChainExtent.width = std::clamp(swapChainExtent.width, surfaceCapabilities.minImageExtent.width, surfaceCapabilities.maxImageExtent.width);
+			swapChainExtent.height = std::clamp(swapChainExtent.height, surfaceCapabilities.minImageExtent.height, surfaceCapabilities.maxImageExtent.height);
+		}
+
+		// A minimized window has a zero extent, which a swap chain can't be created with.
+		// Keep the old swap chain (if any) and stay dirty until the window is restored.
+		if (swapChainExtent.width == 0 || swapChainExtent.height == 0)
+			return false;
+
+		m_SwapChainPresentMode = SelectPresentMode();
+
+		// Get the image count.
+		uint32_t imageCount = surfaceCapabilities.minImageCount + 1;
+		if (surfaceCapabilities.maxImageCount > 0 && imageCount > surfaceCapabilities.maxImageCount)
+			imageCount = surfaceCapabilities.maxImageCount;
+
+		VkSwapchainCreateInfoKHR swapChainCreateInfo{};
+		swapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+		swapChainCreateInfo.surface = m_pSurface;
+		swapChainCreateInfo.minImageCount = imageCount;
+		swapChainCreateInfo.imageFormat = m_SwapChainSurfaceFormat.format;
+		swapChainCreateInfo.imageColorSpace = m_SwapChainSurfaceFormat.colorSpace;
+		swapChainCreateInfo.imageExtent = swapChainExtent;
+		swapChainCreateInfo.imageArrayLayers = 1;
+		swapChainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+
+		auto indices = std::to_array({ m_GraphicsQueueFamilyIndex, m_PresentQueueFamilyIndex });
+		if (m_GraphicsQueueFamilyIndex != m_PresentQueueFamilyIndex)
+		{
+			swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+			swapChainCreateInfo.queueFamilyIndexCount = static_cast<uint32_t>(indices.size());
+			swapChainCreateInfo.pQueueFamilyIndices = indices.data();
+		}
+		else
+			swapChainCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		swapChainCreateInfo.preTransform = surfaceCapabilities.currentTransform;
+		swapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+		swapChainCreateInfo.presentMode = m_SwapChainPresentMode;
+		swapChainCreateInfo.clipped = VK_TRUE;
+		// Passing the old swap chain lets the driver reuse its resources and keeps its presented images valid.
+		swapChainCreateInfo.oldSwapchain = m_pSwapChain;
+
+		VkSwapchainKHR pSwapChain;
+		result = m_DeviceDispatch.vkCreateSwapchainKHR(m_pDevice, &swapChainCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &pSwapChain);
+		assert(result == VK_SUCCESS && "Failed to create swap chain.");
+
+		// Frames that are still in flight may reference the old swap chain's images, so retire it instead of waiting
+		// for the device to go idle. Nothing says when its last present is done with its images and semaphores either,
+		// so it's kept until MAX_FRAMES_IN_FLIGHT frames after the first one with the new swap chain are done too.
+		if (m_pSwapChain != VK_NULL_HANDLE)
+		{
+			rendering::TimelinePoint retirePoint = GetFrameTimelinePoint();
+			retirePoint.value += MAX_FRAMES_IN_FLIGHT;
+			for (VkImageView pImageView : m_SwapChainImageViews)
+				m_DeletionQueue.Retire(retirePoint, pImageView);
+			for (VkSemaphore pSemaphore : m_SwapChainRenderFinishedSemaphores)
+				m_DeletionQueue.Retire(retirePoint, pSemaphore);
+			m_DeletionQueue.Retire(retirePoint, m_pSwapChain);
+			m_SwapChainImageViews.clear();
+			m_SwapChainRenderFinishedSemaphores.clear();
+		}
+
+		m_pSwapChain = pSwapChain;
+		m_SwapChainFormat = m_SwapChainSurfaceFormat.format;
+		m_SwapChainExtent = swapChainExtent;
+		m_SwapChainDirty = false;
+
+		// Get swap chain image handles.
+		uint32_t swapChainImageCount;
+		result = m_DeviceDispatch.vkGetSwapchainImagesKHR(m_pDevice, m_pSwapChain, &swapChainImageCount, nullptr);
+		assert(result == VK_SUCCESS && "Failed to get swap chain image count.");
+		m_SwapChainImages.resize(swapChainImageCount);
+		result = m_DeviceDispatch.vkGetSwapchainImagesKHR(m_pDevice, m_pSwapChain, &swapChainImageCount, m_SwapChainImages.data());
+		assert(result == VK_SUCCESS && "Failed to get swap chain images.");
+		// New images haven't been used yet, so their contents are undefined.
+		m_SwapChainImageLayouts.assign(m_SwapChainImages.size(), VK_IMAGE_LAYOUT_UNDEFINED);
+
+		// Create swap chain image views
+		PROFILE_SCOPE("Create Swap Chain Image Views");
+		VkImageViewCreateInfo imageViewCreateInfo{};
+		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageViewCreateInfo.format = m_SwapChainFormat;
+		imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+		m_SwapChainImageViews.resize(m_SwapChainImages.size());
+		for (size_t i = 0; i < m_SwapChainImages.size(); i++)
+		{
+			imageViewCreateInfo.image = m_SwapChainImages[i];
+			result = m_DeviceDispatch.vkCreateImageView(m_pDevice, &imageViewCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &m_SwapChainImageViews[i]);
+			assert(result == VK_SUCCESS && "Failed to create swap chain image view.");
+		}
+
+		// Present waits on these, and nothing says when it's done with one except the image being acquired again, so
+		// there's one per image instead of one per frame in flight.
+		VkSemaphoreCreateInfo semaphoreCreateInfo{};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		m_SwapChainRenderFinishedSemaphores.resize(m_SwapChainImages.size());
+		for (VkSemaphore& rpSemaphore : m_SwapChainRenderFinishedSemaphores)
+		{
+			result = m_DeviceDispatch.vkCreateSemaphore(m_pDevice, &semaphoreCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &rpSemaphore);
+			assert(result == VK_SUCCESS && "Failed to create render finished semaphore.");
+		}
+
+		return true;
+	}
+
+	VkPresentModeKHR Application::SelectPresentMode() const
+	{
+		uint32_t presentModeCount;
+		VkResult result = vkGetPhysicalDeviceSurfacePresentModesKHR(m_pPhysicalDevice, m_pSurface, &presentModeCount, nullptr);
+		assert(result == VK_SUCCESS && "Failed to get physical device surface present mode count.");
+		std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+		result = vkGetPhysicalDeviceSurfacePresentModesKHR(m_pPhysicalDevice, m_pSurface, &presentModeCount, presentModes.data());
+		assert(result == VK_SUCCESS && "Failed to get physical device surface present modes.");
+
+		// Every chain ends in VK_PRESENT_MODE_FIFO_KHR, since it's the only one that's gaurenteed to exist.
+		static constexpr auto latencyFirstChain = std::to_array({
+			VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR
+		});
+		static constexpr auto throughputFirstChain = std::to_array({
+			VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR
+		});
+		static constexpr auto powerSaveChain = std::to_array({
+			VK_PRESENT_MODE_FIFO_KHR
+		});
+
+		std::span<const VkPresentModeKHR> fallbackChain;
+		switch (m_PresentModePolicy)
+		{
+			case PresentModePolicy::LatencyFirst: fallbackChain = latencyFirstChain; break;
+			case PresentModePolicy::ThroughputFirst: fallbackChain = throughputFirstChain; break;
+			case PresentModePolicy::PowerSave: fallbackChain = powerSaveChain; break;
+		}
+
+		for (VkPresentModeKHR presentMode : fallbackChain)
+			if (std::find(presentModes.begin(), presentModes.end(), presentMode) != presentModes.end())
+				return presentMode;
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	void Application::CreateOffscreenTargets(VkExtent2D extent)
+	{
+		PROFILE_FUNCTION();
+
+		m_OffscreenExtent = extent;
+		m_SwapChainFormat = OFFSCREEN_FORMAT;
+		m_SwapChainExtent = extent;
+
+		VkImageCreateInfo imageCreateInfo{};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = OFFSCREEN_FORMAT;
+		imageCreateInfo.extent = { extent.width, extent.height, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkImageViewCreateInfo imageViewCreateInfo{};
+		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageViewCreateInfo.format = OFFSCREEN_FORMAT;
+		imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+		VkBufferCreateInfo bufferCreateInfo{};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = static_cast<VkDeviceSize>(extent.width) * extent.height * OFFSCREEN_BYTES_PER_PIXEL;
+		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		// Render targets are big and live as long as the extent does, so they get dedicated allocations.
+		rendering::AllocationCreateInfo imageAllocationCreateInfo;
+		imageAllocationCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		imageAllocationCreateInfo.linear = false;
+		imageAllocationCreateInfo.dedicated = true;
+
+		// Cached memory makes reading the pixels on the CPU much faster, but isn't required.
+		rendering::AllocationCreateInfo readbackAllocationCreateInfo;
+		readbackAllocationCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		readbackAllocationCreateInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		readbackAllocationCreateInfo.mapped = true;
+
+		for (OffscreenTarget& rTarget : m_OffscreenTargets)
+		{
+			VkResult result = m_DeviceDispatch.vkCreateImage(m_pDevice, &imageCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &rTarget.pImage);
+			assert(result == VK_SUCCESS && "Failed to create offscreen image.");
+			rTarget.imageAllocation = m_DeviceAllocator.AllocateImage(rTarget.pImage, imageAllocationCreateInfo);
+
+			imageViewCreateInfo.image = rTarget.pImage;
+			result = m_DeviceDispatch.vkCreateImageView(m_pDevice, &imageViewCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &rTarget.pImageView);
+			assert(result == VK_SUCCESS && "Failed to create offscreen image view.");
+			rTarget.imageState = {};
+
+			// Only frames that get read back need a host visible copy.
+			if (!m_ReadbackCallback)
+				continue;
+
+			result = m_DeviceDispatch.vkCreateBuffer(m_pDevice, &bufferCreateInfo, m_DeviceDispatch.cpAllocationCallbacks, &rTarget.pReadbackBuffer);
+			assert(result == VK_SUCCESS && "Failed to create readback buffer.");
+			rTarget.readbackAllocation = m_DeviceAllocator.AllocateBuffer(rTarget.pReadbackBuffer, readbackAllocationCreateInfo);
+		}
+	}
+
+	void Application::DestroyOffscreenTargets()
+	{
+		for (OffscreenTarget& rTarget : m_OffscreenTargets)
+		{
+			if (rTarget.pReadbackBuffer != VK_NULL_HANDLE)
+			{
+				m_DeviceDispatch.vkDestroyBuffer(m_pDevice, rTarget.pReadbackBuffer, m_DeviceDispatch.cpAllocationCallbacks);
+				m_DeviceAllocator.Free(rTarget.readbackAllocation);
+			}
+			m_DeviceDispatch.vkDestroyImageView(m_pDevice, rTarget.pImageView, m_DeviceDispatch.cpAllocationCallbacks);
+			m_DeviceDispatch.vkDestroyImage(m_pDevice, rTarget.pImage, m_DeviceDispatch.cpAllocationCallbacks);
+			m_DeviceAllocator.Free(rTarget.imageAllocation);
+		}
+	}
+
+	void Application::ConsumeReadback(OffscreenTarget& rTarget)
+	{
+		if (!rTarget.readbackPending)
+			return;
+		rTarget.readbackPending = false;
+
+		PROFILE_FUNCTION();
+
+		m_DeviceAllocator.InvalidateMapped(rTarget.readbackAllocation);
+		m_ReadbackCallback(rTarget.readbackAllocation.pMappedData, m_OffscreenExtent, OFFSCREEN_FORMAT);
+	}
+
+	void Application::DestroySwapChain(VkSwapchainKHR pSwapChain, const std::vector<VkImageView>& crImageViews, const std::vector<VkSemaphore>& crRenderFinishedSemaphores)
+	{
+		for (VkImageView pImageView : crImageViews)
+			m_DeviceDispatch.vkDestroyImageView(m_pDevice, pImageView, m_DeviceDispatch.cpAllocationCallbacks);
+		for (VkSemaphore pSemaphore : crRenderFinishedSemaphores)
+			m_DeviceDispatch.vkDestroySemaphore(m_pDevice, pSemaphore, m_DeviceDispatch.cpAllocationCallbacks);
+		m_DeviceDispatch.vkDestroySwapchainKHR(m_pDevice, pSwapChain, m_DeviceDispatch.cpAllocationCallbacks);
+	}
+
+	void Application::RecordFrame(VkCommandBuffer pCommandBuffer, uint32_t imageIndex)
+	{
+		PROFILE_FUNCTION();
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo{};
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		VkResult result = m_DeviceDispatch.vkBeginCommandBuffer(pCommandBuffer, &commandBufferBeginInfo);
+		assert(result == VK_SUCCESS && "Failed to begin frame command buffer.");
+
+		// Before recording the secondaries, since they may add their own scopes.
+		m_GpuProfiler.BeginFrame(m_FrameIndex, pCommandBuffer);
+		uint32_t frameScope = m_GpuProfiler.BeginScope(pCommandBuffer, "Frame");
+
+		// Every render task gets its own secondary, recorded in parallel on the recording threads.
+		VkCommandBufferInheritanceRenderingInfo commandBufferInheritanceRenderingInfo{};
+		commandBufferInheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+		commandBufferInheritanceRenderingInfo.colorAttachmentCount = 1;
+		commandBufferInheritanceRenderingInfo.pColorAttachmentFormats = &m_SwapChainFormat;
+		commandBufferInheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		std::span<const VkCommandBuffer> secondaryCommandBuffers = m_CommandRecorder.Record(commandBufferInheritanceRenderingInfo, m_RenderTasks);
+
+		// The frame's passes declare what they use, and the render graph works out the barriers between them.
+		m_RenderGraph.Reset();
+		rendering::RenderResource colorTarget;
+		if (m_Headless)
+			colorTarget = m_RenderGraph.ImportImage("Offscreen Target", m_OffscreenTargets[imageIndex].pImage, VK_IMAGE_ASPECT_COLOR_BIT, m_OffscreenTargets[imageIndex].imageState);
+		else
+		{
+			// The first use has to wait for the stage the acquire semaphore is waited on.
+			rendering::ImageState swapChainImageState{ m_SwapChainImageLayouts[imageIndex], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE };
+			colorTarget = m_RenderGraph.ImportImage("Swap Chain Image", m_SwapChainImages[imageIndex], VK_IMAGE_ASPECT_COLOR_BIT, swapChainImageState);
+			m_RenderGraph.Export(colorTarget, rendering::ResourceUsage::Present);
+		}
+
+		m_RenderGraph.AddPass("Main Pass", [this, imageIndex, secondaryCommandBuffers](VkCommandBuffer pCommandBuffer)
+		{
+			uint32_t mainPassScope = m_GpuProfiler.BeginScope(pCommandBuffer, "Main Pass");
+
+			VkRenderingAttachmentInfo colorAttachmentInfo{};
+			colorAttachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+			colorAttachmentInfo.imageView = m_Headless ? m_OffscreenTargets[imageIndex].pImageView : m_SwapChainImageViews[imageIndex];
+			colorAttachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colorAttachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			colorAttachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			colorAttachmentInfo.clearValue.color = { { 0.1f, 0.1f, 0.1f, 1.0f } };
+
+			VkRenderingInfo renderingInfo{};
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+			renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+			renderingInfo.renderArea = { { 0, 0 }, m_SwapChainExtent };
+			renderingInfo.layerCount = 1;
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colorAttachmentInfo;
+
+			m_DeviceDispatch.vkCmdBeginRendering(pCommandBuffer, &renderingInfo);
+			if (!secondaryCommandBuffers.empty())
+				m_DeviceDispatch.vkCmdExecuteCommands(pCommandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+			m_DeviceDispatch.vkCmdEndRendering(pCommandBuffer);
+			m_GpuProfiler.EndScope(pCommandBuffer, mainPassScope);
+		}).Use(colorTarget, rendering::ResourceUsage::ColorAttachmentWrite);
+
+		if (!m_RenderGraphCallbacks.empty())
+		{
+			FrameColorTarget frameColorTarget;
+			frameColorTarget.resource = colorTarget;
+			frameColorTarget.pImageView = m_Headless ? m_OffscreenTargets[imageIndex].pImageView : m_SwapChainImageViews[imageIndex];
+			frameColorTarget.format = m_SwapChainFormat;
+			frameColorTarget.extent = m_SwapChainExtent;
+			for (const RenderGraphCallback& crCallback : m_RenderGraphCallbacks)
+				crCallback(m_RenderGraph, frameColorTarget);
+		}
+
+		if (m_Headless)
+		{
+			if (m_ReadbackCallback)
+			{
+				const OffscreenTarget& crTarget = m_OffscreenTargets[imageIndex];
+				rendering::RenderResource readbackBuffer = m_RenderGraph.ImportBuffer("Readback Buffer", crTarget.pReadbackBuffer);
+				m_RenderGraph.AddPass("Readback Copy", [this, &crTarget](VkCommandBuffer pCommandBuffer)
+				{
+					uint32_t readbackScope = m_GpuProfiler.BeginScope(pCommandBuffer, "Readback Copy");
+
+					VkBufferImageCopy bufferImageCopy{};
+					bufferImageCopy.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+					bufferImageCopy.imageSubresource.layerCount = 1;
+					bufferImageCopy.imageExtent = { m_OffscreenExtent.width, m_OffscreenExtent.height, 1 };
+					m_DeviceDispatch.vkCmdCopyImageToBuffer(pCommandBuffer, crTarget.pImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, crTarget.pReadbackBuffer, 1, &bufferImageCopy);
+
+					m_GpuProfiler.EndScope(pCommandBuffer, readbackScope);
+				}).Use(colorTarget, rendering::ResourceUsage::TransferRead).Use(readbackBuffer, rendering::ResourceUsage::TransferWrite);
+
+				// Makes the copy visible to the host once the frame is waited on.
+				m_RenderGraph.Export(readbackBuffer, rendering::ResourceUsage::HostRead);
+			}
+			else
+				m_RenderGraph.Export(colorTarget);
+		}
+
+		m_RenderGraph.Compile(GetFrameTimelinePoint());
+		m_RenderGraph.Execute(pCommandBuffer);
+
+		// Where the graph left the image is where the next frame that uses it starts from.
+		if (m_Headless)
+			m_OffscreenTargets[imageIndex].imageState = m_RenderGraph.GetFinalState(colorTarget);
+		else
+			m_SwapChainImageLayouts[imageIndex] = m_RenderGraph.GetFinalState(colorTarget).layout;
+
+		m_GpuProfiler.EndScope(pCommandBuffer, frameScope);
+		result = m_DeviceDispatch.vkEndCommandBuffer(pCommandBuffer);
+		assert(result == VK_SUCCESS && "Failed to end frame command buffer.");
 	}
 }
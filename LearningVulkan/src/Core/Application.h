@@ -1,7 +1,29 @@
 #pragma once
 
+#include "Core/FrameStatistics.h"
+#include "Core/JobSystem.h"
+#include "Core/StartupStatistics.h"
+#include "Rendering/ComputeQueue.h"
+#include "Rendering/DebugMessageSink.h"
+#include "Rendering/DeletionQueue.h"
+#include "Rendering/DeviceAllocator.h"
+#include "Rendering/DeviceDispatch.h"
+#include "Rendering/GpuProfiler.h"
+#include "Rendering/HostAllocator.h"
+#include "Rendering/InstanceDispatch.h"
+#include "Rendering/ParallelCommandRecorder.h"
+#include "Rendering/PipelineCache.h"
+#include "Rendering/QueueTimeline.h"
+#include "Rendering/RenderGraph.h"
+#include "Rendering/SubmitBatcher.h"
+#include "Rendering/UploadService.h"
 #define GLFW_INCLUDE_VULKAN
 #include <glfw/glfw3.h>
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace core
@@ -10,31 +32,256 @@ namespace core
 	static constexpr int32_t WINDOW_HEIGHT = 720;
 	static constexpr const char WINDOW_TITLE[] = "Minecraft Recoded";
 
+	// How many frames the CPU may record ahead of the GPU.
+	static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+	static_assert(MAX_FRAMES_IN_FLIGHT >= 2 && MAX_FRAMES_IN_FLIGHT <= 3, "MAX_FRAMES_IN_FLIGHT must be 2 or 3.");
+
+	// Relative to the working directory.
+	static constexpr const char PIPELINE_CACHE_DIRECTORY[] = "Cache";
+
+	// Size of the upload service's staging ring buffer. Uploads bigger than this have to be split up by the caller.
+	static constexpr VkDeviceSize UPLOAD_STAGING_CAPACITY = 64ull << 20;
+
+	// How the swap chain's present mode is picked. Each policy walks a fallback chain
+	// of present modes and takes the first one the surface supports.
+	enum class PresentModePolicy : uint8_t
+	{
+		// MAILBOX -> IMMEDIATE -> FIFO_RELAXED -> FIFO
+		LatencyFirst,
+		// IMMEDIATE -> MAILBOX -> FIFO_RELAXED -> FIFO, uncapped for measuring render throughput.
+		ThroughputFirst,
+		// FIFO, capped to the refresh rate.
+		PowerSave
+	};
+
+	// Called with a headless frame's pixels once the GPU is done with it. cpPixels is tightly
+	// packed and only valid for the duration of the call.
+	using ReadbackCallback = std::function<void(const void* cpPixels, VkExtent2D extent, VkFormat format)>;
+
+	// Called on the thread calling Run() before each frame is recorded, e.g. to move the camera, queue uploads
+	// or add frame waits. Called again with the same frame number if the frame couldn't be drawn.
+	using FrameCallback = std::function<void(uint64_t frameNumber)>;
+
+	// The frame's color target, for passes added to the frame's render graph.
+	struct FrameColorTarget
+	{
+		rendering::RenderResource resource = 0;
+		VkImageView pImageView = VK_NULL_HANDLE;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+	};
+
+	// Adds passes to the frame's render graph, e.g. ones that draw on top of the color target with
+	// ResourceUsage::ColorAttachmentReadWrite. Transient images it creates are only needed for the frame.
+	using RenderGraphCallback = std::function<void(rendering::RenderGraph& rGraph, const FrameColorTarget& crColorTarget)>;
+
+	// Startup work that doesn't depend on Vulkan, e.g. loading shaders, config files or the asset index.
+	struct StartupJob
+	{
+		// Must be a string literal, it names the job's startup phase.
+		const char* cpName = nullptr;
+		JobSystem::JobFunction function;
+	};
+
+	struct ApplicationSpecification
+	{
+		// Render into device-local offscreen images instead of a window.
+		// No GLFW window, surface or swap chain is created, so no display server is needed.
+		bool headless = false;
+		VkExtent2D headlessExtent{ WINDOW_WIDTH, WINDOW_HEIGHT };
+		// Only used in headless mode. Frames are only copied back to the host if this is set.
+		ReadbackCallback readbackCallback;
+
+		FrameCallback frameCallback;
+
+		// Run() returns after this many frames. 0 means run until the window is closed (or Close() is called).
+		uint64_t frameLimit = 0;
+
+		PresentModePolicy presentModePolicy = PresentModePolicy::PowerSave;
+
+		// Use this physical device if it's suitable, instead of the highest scoring one.
+		// Either part of the device name or its UUID as 32 hex digits (dashes are ignored).
+		std::string preferredDevice;
+
+		// How many job system workers run besides the main thread. Chunk generation, meshing, asset decoding and
+		// command recording all run on them. Defaults to one per remaining hardware thread.
+		uint32_t jobWorkerCount = JobSystem::AUTO_WORKER_COUNT;
+
+		// Every frame's timings are written here as CSV, unless it's empty.
+		std::filesystem::path frameStatisticsFilepath;
+
+		// Run as jobs alongside instance and device creation. They're all done by the time the constructor returns.
+		std::vector<StartupJob> startupJobs;
+	};
+
 	class Application
 	{
 	public:
-		Application();
+		Application(const ApplicationSpecification& crSpecification = {});
 		~Application();
 	public:
 		void Run();
+		void Close();
+
+		// Takes effect on the next frame by rebuilding the swap chain.
+		void SetPresentModePolicy(PresentModePolicy policy);
+		inline PresentModePolicy GetPresentModePolicy() const noexcept { return m_PresentModePolicy; }
+		inline VkPresentModeKHR GetPresentMode() const noexcept { return m_SwapChainPresentMode; }
+
+		inline JobSystem& GetJobSystem() noexcept { return m_JobSystem; }
+		inline const VkPhysicalDeviceProperties& GetPhysicalDeviceProperties() const noexcept { return m_PhysicalDeviceProperties; }
+		inline VkDevice GetDevice() const noexcept { return m_pDevice; }
+		inline const rendering::DeviceDispatch& GetDeviceDispatch() const noexcept { return m_DeviceDispatch; }
+		inline rendering::DeviceAllocator& GetDeviceAllocator() noexcept { return m_DeviceAllocator; }
+		// Uploads recorded before a frame is drawn are flushed and waited on by that frame's submit.
+		inline rendering::UploadService& GetUploadService() noexcept { return m_UploadService; }
+		// On devices without a separate compute family this shares the graphics queue, but has its own timeline.
+		inline rendering::ComputeQueue& GetComputeQueue() noexcept { return m_ComputeQueue; }
+		// Times the graphics queue's work. Render tasks can add their own scopes to their secondaries.
+		inline rendering::GpuProfiler& GetGpuProfiler() noexcept { return m_GpuProfiler; }
+		inline const FrameStatistics& GetFrameStatistics() const noexcept { return m_FrameStatistics; }
+		inline const StartupStatistics& GetStartupStatistics() const noexcept { return m_StartupStatistics; }
+		// Counts the driver's host allocations for the instance, the device and everything created from them.
+		inline const rendering::HostAllocator& GetHostAllocator() const noexcept { return m_HostAllocator; }
+		// How much device memory aliasing the render graph's transient images saves.
+		inline const rendering::TransientMemoryStatistics& GetTransientMemoryStatistics() const noexcept { return m_RenderGraph.GetTransientMemoryStatistics(); }
+
+		// Signaled once the frame currently being built is done on the GPU. Resources the frame (or an earlier one) uses
+		// can be retired with it, and are destroyed once it's reached.
+		inline rendering::TimelinePoint GetFrameTimelinePoint() const noexcept { return m_GraphicsTimeline.GetNextPoint(); }
+		inline rendering::DeletionQueue& GetDeletionQueue() noexcept { return m_DeletionQueue; }
+
+		// The next frame's graphics submit waits on the GPU until the timeline semaphore reaches the value,
+		// e.g. to consume the results of async compute work. Must be called from the thread calling Run().
+		void AddFrameWait(const rendering::TimelineWait& crWait);
+
+		// Recorded every frame into its own secondary command buffer, inside the frame's dynamic rendering
+		// of the color target. Tasks run in parallel as jobs, in no particular order.
+		void AddRenderTask(rendering::ParallelCommandRecorder::RecordFunction task);
+		// Called every frame on the thread calling Run() while the frame's render graph is built, after the main pass.
+		// Callbacks are called in the order they're added.
+		void AddRenderGraphCallback(RenderGraphCallback callback);
 	private:
+		// Runs as a job, so it must only touch the instance's members.
+		void CreateInstance(const std::vector<const char*>& crRequiredExtensions);
+
+		void DrawFrame();
+		void RecordFrame(VkCommandBuffer pCommandBuffer, uint32_t imageIndex);
+		// Submits everything every subsystem batched up during the frame, one vkQueueSubmit2 per queue.
+		void FlushSubmissions();
+
+		// Returns false if the surface currently has a zero extent (e.g. minimized).
+		bool CreateSwapChain();
+		VkPresentModeKHR SelectPresentMode() const;
+		void DestroySwapChain(VkSwapchainKHR pSwapChain, const std::vector<VkImageView>& crImageViews, const std::vector<VkSemaphore>& crRenderFinishedSemaphores);
 
+		void CreateOffscreenTargets(VkExtent2D extent);
+		void DestroyOffscreenTargets();
 	private:
-		GLFWwindow* m_pWindow;
+		// Everything one frame needs that can't be touched until that frame's submission is done.
+		struct FrameData
+		{
+			VkCommandPool pCommandPool = VK_NULL_HANDLE;
+			VkCommandBuffer pCommandBuffer = VK_NULL_HANDLE;
+			VkSemaphore pImageAvailableSemaphore = VK_NULL_HANDLE;
+			// The graphics timeline value the frame's submission signals. 0 until it's first submitted.
+			uint64_t timelineValue = 0;
+		};
 
+		// What a headless frame renders into in place of a swap chain image.
+		struct OffscreenTarget
+		{
+			VkImage pImage = VK_NULL_HANDLE;
+			rendering::Allocation imageAllocation;
+			VkImageView pImageView = VK_NULL_HANDLE;
+			// Where the last frame that rendered to it left it.
+			rendering::ImageState imageState;
+			VkBuffer pReadbackBuffer = VK_NULL_HANDLE;
+			rendering::Allocation readbackAllocation;
+			bool readbackPending = false;
+		};
+
+		static constexpr VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+		static constexpr uint32_t OFFSCREEN_BYTES_PER_PIXEL = 4;
+	private:
+		void ConsumeReadback(OffscreenTarget& rTarget);
+	private:
+		bool m_Headless = false;
+		bool m_Running = false;
+		uint64_t m_FrameLimit = 0;
+
+		JobSystem m_JobSystem;
+
+		GLFWwindow* m_pWindow = nullptr;
+
+		rendering::HostAllocator m_HostAllocator;
+#if !CONFIG_DIST // ENABLE_LOGGING
+		rendering::DebugMessageSink m_DebugMessageSink;
+#endif
 		VkInstance m_pInstance = VK_NULL_HANDLE;
+		rendering::InstanceDispatch m_InstanceDispatch;
 #if !CONFIG_DIST // ENABLE_LOGGING
 		VkDebugUtilsMessengerEXT m_pDebugMessenger = VK_NULL_HANDLE;
 #endif
 		VkPhysicalDevice m_pPhysicalDevice = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties m_PhysicalDeviceProperties{};
+		VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+		std::vector<const char*> m_EnabledOptionalDeviceExtensions;
 		VkDevice m_pDevice = VK_NULL_HANDLE;
+		rendering::DeviceDispatch m_DeviceDispatch;
+		rendering::DeviceAllocator m_DeviceAllocator;
+		rendering::PipelineCache m_PipelineCache;
 		VkQueue m_pGraphicsQueue = VK_NULL_HANDLE;
 		VkSurfaceKHR m_pSurface = VK_NULL_HANDLE;
 		VkQueue m_pPresentQueue = VK_NULL_HANDLE;
+		// One per distinct queue, shared by every role that uses it. All submissions and presents go through these.
+		std::unordered_map<VkQueue, rendering::SubmitBatcher> m_SubmitBatchers;
+		rendering::SubmitBatcher* m_pPresentBatcher = nullptr;
 		VkSwapchainKHR m_pSwapChain = VK_NULL_HANDLE;
+		VkSurfaceFormatKHR m_SwapChainSurfaceFormat{};
+		PresentModePolicy m_PresentModePolicy = PresentModePolicy::PowerSave;
+		VkPresentModeKHR m_SwapChainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
 		VkFormat m_SwapChainFormat = VK_FORMAT_UNDEFINED;
 		VkExtent2D m_SwapChainExtent{};
 		std::vector<VkImage> m_SwapChainImages;
+		// Where each image was left by the last frame that rendered to it, tracked by the render graph.
+		std::vector<VkImageLayout> m_SwapChainImageLayouts;
 		std::vector<VkImageView> m_SwapChainImageViews;
+		// Signaled by the frame that renders to the image, and waited on by its present. Indexed by image.
+		std::vector<VkSemaphore> m_SwapChainRenderFinishedSemaphores;
+		uint32_t m_GraphicsQueueFamilyIndex = 0;
+		uint32_t m_PresentQueueFamilyIndex = 0;
+		VkQueue m_pTransferQueue = VK_NULL_HANDLE;
+		uint32_t m_TransferQueueFamilyIndex = 0;
+		rendering::UploadService m_UploadService;
+		// The last upload timeline value a graphics submit waited on, so finished uploads aren't waited on again.
+		uint64_t m_WaitedUploadValue = 0;
+		VkQueue m_pComputeQueue = VK_NULL_HANDLE;
+		uint32_t m_ComputeQueueFamilyIndex = 0;
+		rendering::ComputeQueue m_ComputeQueue;
+		// Every submission to a queue goes through a timeline, so anything can be waited on without fences.
+		rendering::QueueTimeline m_GraphicsTimeline;
+		rendering::QueueTimeline m_TransferTimeline;
+		rendering::QueueTimeline m_ComputeTimeline;
+		std::vector<rendering::TimelineWait> m_FrameWaits;
+		bool m_SwapChainDirty = false;
+		rendering::DeletionQueue m_DeletionQueue;
+
+		// Only used in headless mode. One per frame in flight, so one can be read back while the next is rendered.
+		std::array<OffscreenTarget, MAX_FRAMES_IN_FLIGHT> m_OffscreenTargets;
+		VkExtent2D m_OffscreenExtent{};
+		ReadbackCallback m_ReadbackCallback;
+		FrameCallback m_FrameCallback;
+
+		std::array<FrameData, MAX_FRAMES_IN_FLIGHT> m_Frames;
+		rendering::ParallelCommandRecorder m_CommandRecorder;
+		rendering::RenderGraph m_RenderGraph;
+		rendering::GpuProfiler m_GpuProfiler;
+		FrameStatistics m_FrameStatistics;
+		StartupStatistics m_StartupStatistics;
+		std::vector<rendering::ParallelCommandRecorder::RecordFunction> m_RenderTasks;
+		std::vector<RenderGraphCallback> m_RenderGraphCallbacks;
+		uint32_t m_FrameIndex = 0;
+		uint64_t m_FrameNumber = 0;
 	};
 }
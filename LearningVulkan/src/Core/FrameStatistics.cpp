@@ -0,0 +1,213 @@
+#include "Core/FrameStatistics.h"
+#include <assert.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+namespace core
+{
+	void FrameTimeHistogram::Add(uint64_t microseconds) noexcept
+	{
+		m_Buckets[GetBucketIndex(microseconds)]++;
+		m_Count++;
+	}
+
+	void FrameTimeHistogram::Remove(uint64_t microseconds) noexcept
+	{
+		uint32_t bucketIndex = GetBucketIndex(microseconds);
+		assert(m_Buckets[bucketIndex] > 0 && "Removing a sample that was never added.");
+		m_Buckets[bucketIndex]--;
+		m_Count--;
+	}
+
+	void FrameTimeHistogram::Clear() noexcept
+	{
+		m_Buckets.fill(0);
+		m_Count = 0;
+	}
+
+	uint64_t FrameTimeHistogram::GetPercentile(double p) const noexcept
+	{
+		if (m_Count == 0)
+			return 0;
+
+		uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * static_cast<double>(m_Count))));
+		uint64_t cumulativeCount = 0;
+		for (uint32_t i = 0; i < BUCKET_COUNT; i++)
+		{
+			cumulativeCount += m_Buckets[i];
+			if (cumulativeCount >= rank)
+				return GetBucketMiddle(i);
+		}
+		return GetBucketMiddle(BUCKET_COUNT - 1);
+	}
+
+	uint32_t FrameTimeHistogram::GetBucketIndex(uint64_t microseconds) noexcept
+	{
+		// Values below SUB_BUCKET_COUNT get a bucket each. Above that, the top SUB_BUCKET_BITS + 1 bits pick the bucket.
+		if (microseconds < SUB_BUCKET_COUNT)
+			return static_cast<uint32_t>(microseconds);
+
+		uint32_t exponent = static_cast<uint32_t>(std::bit_width(microseconds)) - (SUB_BUCKET_BITS + 1);
+		uint32_t mantissa = static_cast<uint32_t>(microseconds >> exponent) - SUB_BUCKET_COUNT;
+		return std::min(SUB_BUCKET_COUNT + exponent * SUB_BUCKET_COUNT + mantissa, BUCKET_COUNT - 1);
+	}
+
+	uint64_t FrameTimeHistogram::GetBucketMiddle(uint32_t bucketIndex) noexcept
+	{
+		if (bucketIndex < SUB_BUCKET_COUNT)
+			return bucketIndex;
+
+		uint32_t exponent = (bucketIndex - SUB_BUCKET_COUNT) / SUB_BUCKET_COUNT;
+		uint64_t mantissa = SUB_BUCKET_COUNT + (bucketIndex - SUB_BUCKET_COUNT) % SUB_BUCKET_COUNT;
+		return (mantissa << exponent) + ((1ull << exponent) >> 1);
+	}
+
+	void FrameStatistics::Create(const std::filesystem::path& crCsvFilepath)
+	{
+		for (MetricData& rMetric : m_Metrics)
+		{
+			rMetric.rollingHistogram.Clear();
+			rMetric.sessionHistogram.Clear();
+			rMetric.window.assign(WINDOW_SIZE, NO_SAMPLE);
+			rMetric.sessionMax = 0;
+		}
+		m_CurrentFrame.fill(NO_SAMPLE);
+		m_WindowIndex = 0;
+
+		if (crCsvFilepath.empty())
+			return;
+
+		m_CsvFile.open(crCsvFilepath);
+#if !CONFIG_DIST // ENABLE_LOGGING
+		if (!m_CsvFile)
+			std::cerr << "Failed to open frame statistics file \"" << crCsvFilepath.string() << "\".\n";
+#endif
+
+		m_CsvFile << "frame";
+		for (size_t i = 0; i < METRIC_COUNT; i++)
+			m_CsvFile << ',' << GetMetricName(static_cast<FrameMetric>(i)) << "_ms";
+		m_CsvFile << '\n';
+	}
+
+	void FrameStatistics::Destroy()
+	{
+		if (m_CsvFile.is_open())
+			m_CsvFile.close();
+	}
+
+	void FrameStatistics::BeginFrame(uint64_t frameNumber)
+	{
+		m_CurrentFrameNumber = frameNumber;
+		m_CurrentFrame.fill(NO_SAMPLE);
+	}
+
+	void FrameStatistics::Record(FrameMetric metric, double milliseconds)
+	{
+		m_CurrentFrame[static_cast<size_t>(metric)] = static_cast<uint64_t>(std::max(milliseconds, 0.0) * 1000.0);
+	}
+
+	void FrameStatistics::EndFrame()
+	{
+		for (size_t i = 0; i < METRIC_COUNT; i++)
+		{
+			MetricData& rMetric = m_Metrics[i];
+			uint64_t& rWindowSample = rMetric.window[m_WindowIndex];
+			if (rWindowSample != NO_SAMPLE)
+				rMetric.rollingHistogram.Remove(rWindowSample);
+
+			rWindowSample = m_CurrentFrame[i];
+			if (rWindowSample == NO_SAMPLE)
+				continue;
+
+			rMetric.rollingHistogram.Add(rWindowSample);
+			rMetric.sessionHistogram.Add(rWindowSample);
+			rMetric.sessionMax = std::max(rMetric.sessionMax, rWindowSample);
+		}
+		m_WindowIndex = (m_WindowIndex + 1) % WINDOW_SIZE;
+
+		if (m_CsvFile.is_open())
+		{
+			char field[32];
+			m_CsvFile << m_CurrentFrameNumber;
+			for (uint64_t sample : m_CurrentFrame)
+			{
+				// Missing samples are empty fields.
+				field[0] = '\0';
+				if (sample != NO_SAMPLE)
+					std::snprintf(field, sizeof(field), "%.3f", static_cast<double>(sample) / 1000.0);
+				m_CsvFile << ',' << field;
+			}
+			m_CsvFile << '\n';
+		}
+	}
+
+	FrameMetricSummary FrameStatistics::GetRollingSummary(FrameMetric metric) const
+	{
+		const MetricData& crMetric = m_Metrics[static_cast<size_t>(metric)];
+
+		// The exact max, since the histogram only knows which bucket it's in.
+		uint64_t maxMicroseconds = 0;
+		for (uint64_t sample : crMetric.window)
+			if (sample != NO_SAMPLE)
+				maxMicroseconds = std::max(maxMicroseconds, sample);
+		return Summarize(crMetric.rollingHistogram, maxMicroseconds);
+	}
+
+	FrameMetricSummary FrameStatistics::GetSessionSummary(FrameMetric metric) const
+	{
+		const MetricData& crMetric = m_Metrics[static_cast<size_t>(metric)];
+		return Summarize(crMetric.sessionHistogram, crMetric.sessionMax);
+	}
+
+	void FrameStatistics::PrintSessionSummary(std::ostream& rStream) const
+	{
+		char line[128];
+		std::snprintf(line, sizeof(line), "%-16s %10s %10s %10s %10s %10s\n", "metric (ms)", "frames", "p50", "p95", "p99", "max");
+		rStream << line;
+		for (size_t i = 0; i < METRIC_COUNT; i++)
+		{
+			FrameMetricSummary summary = GetSessionSummary(static_cast<FrameMetric>(i));
+			if (summary.sampleCount == 0)
+				continue;
+
+			std::snprintf(line, sizeof(line), "%-16s %10llu %10.3f %10.3f %10.3f %10.3f\n", GetMetricName(static_cast<FrameMetric>(i)),
+				static_cast<unsigned long long>(summary.sampleCount), summary.p50, summary.p95, summary.p99, summary.max);
+			rStream << line;
+		}
+	}
+
+	const char* FrameStatistics::GetMetricName(FrameMetric metric)
+	{
+		switch (metric)
+		{
+			case FrameMetric::CpuFrameTime: return "cpu_frame";
+			case FrameMetric::GpuFrameTime: return "gpu_frame";
+			case FrameMetric::FrameWait: return "frame_wait";
+			case FrameMetric::AcquireWait: return "acquire_wait";
+			case FrameMetric::PresentWait: return "present_wait";
+			default: return "unknown";
+		}
+	}
+
+	FrameMetricSummary FrameStatistics::Summarize(const FrameTimeHistogram& crHistogram, uint64_t maxMicroseconds)
+	{
+		FrameMetricSummary summary;
+		summary.sampleCount = crHistogram.GetCount();
+		if (summary.sampleCount == 0)
+			return summary;
+
+		// Bucket middles can land past the true max, so clamp them to it.
+		auto percentile = [&crHistogram, maxMicroseconds](double p)
+		{
+			return static_cast<double>(std::min(crHistogram.GetPercentile(p), maxMicroseconds)) / 1000.0;
+		};
+		summary.p50 = percentile(0.50);
+		summary.p95 = percentile(0.95);
+		summary.p99 = percentile(0.99);
+		summary.max = static_cast<double>(maxMicroseconds) / 1000.0;
+		return summary;
+	}
+}
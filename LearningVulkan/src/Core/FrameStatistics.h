@@ -0,0 +1,104 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <ostream>
+#include <vector>
+
+namespace core
+{
+	enum class FrameMetric : uint8_t
+	{
+		// Wall time from one frame to the next, what the player actually sees.
+		CpuFrameTime,
+		// Time the graphics queue spent on the frame. Lags a few frames behind, since it's read back without stalling.
+		GpuFrameTime,
+		// Waiting for the frame's previous submission to finish, i.e. being GPU bound.
+		FrameWait,
+		AcquireWait,
+		PresentWait,
+
+		Count
+	};
+
+	// In milliseconds.
+	struct FrameMetricSummary
+	{
+		uint64_t sampleCount = 0;
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	// Log-linear histogram of microsecond samples (every power of two split into 16 buckets), so percentiles are
+	// within about 6% of the true value no matter how long the tail is, at a fixed size and O(1) per sample.
+	class FrameTimeHistogram
+	{
+	public:
+		static constexpr uint32_t SUB_BUCKET_BITS = 4;
+		static constexpr uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+		// Enough for samples up to 2^40 microseconds.
+		static constexpr uint32_t BUCKET_COUNT = SUB_BUCKET_COUNT * 38;
+	public:
+		void Add(uint64_t microseconds) noexcept;
+		void Remove(uint64_t microseconds) noexcept;
+		void Clear() noexcept;
+
+		// p in [0, 1]. Returns the middle of the bucket the percentile falls in.
+		uint64_t GetPercentile(double p) const noexcept;
+		inline uint64_t GetCount() const noexcept { return m_Count; }
+	private:
+		static uint32_t GetBucketIndex(uint64_t microseconds) noexcept;
+		static uint64_t GetBucketMiddle(uint32_t bucketIndex) noexcept;
+	private:
+		std::array<uint64_t, BUCKET_COUNT> m_Buckets{};
+		uint64_t m_Count = 0;
+	};
+
+	// Collects per frame timings, keeping a rolling window of the last WINDOW_SIZE frames and the whole session.
+	// Metrics that weren't recorded for a frame (e.g. acquire wait in headless mode) are left out of everything.
+	// Not thread safe, everything is fed by the thread calling Application::Run().
+	class FrameStatistics
+	{
+	public:
+		static constexpr uint32_t WINDOW_SIZE = 1024;
+	public:
+		// Writes one CSV row per frame to crCsvFilepath, unless it's empty.
+		void Create(const std::filesystem::path& crCsvFilepath = {});
+		void Destroy();
+
+		void BeginFrame(uint64_t frameNumber);
+		void Record(FrameMetric metric, double milliseconds);
+		void EndFrame();
+
+		FrameMetricSummary GetRollingSummary(FrameMetric metric) const;
+		FrameMetricSummary GetSessionSummary(FrameMetric metric) const;
+		void PrintSessionSummary(std::ostream& rStream) const;
+
+		static const char* GetMetricName(FrameMetric metric);
+	private:
+		static constexpr size_t METRIC_COUNT = static_cast<size_t>(FrameMetric::Count);
+		static constexpr uint64_t NO_SAMPLE = UINT64_MAX;
+
+		struct MetricData
+		{
+			FrameTimeHistogram rollingHistogram;
+			FrameTimeHistogram sessionHistogram;
+			// Ring buffer of the last WINDOW_SIZE frames, NO_SAMPLE where the metric wasn't recorded.
+			std::vector<uint64_t> window;
+			uint64_t sessionMax = 0;
+		};
+	private:
+		static FrameMetricSummary Summarize(const FrameTimeHistogram& crHistogram, uint64_t maxMicroseconds);
+	private:
+		std::array<MetricData, METRIC_COUNT> m_Metrics;
+		std::array<uint64_t, METRIC_COUNT> m_CurrentFrame{};
+		uint64_t m_CurrentFrameNumber = 0;
+		uint32_t m_WindowIndex = 0;
+
+		std::ofstream m_CsvFile;
+	};
+}
@@ -0,0 +1,232 @@
+#include "Core/JobSystem.h"
+#include "Core/Profiler.h"
+#include <algorithm>
+
+namespace core
+{
+	// Which deque the current thread owns, or UINT32_MAX if it isn't part of a job system.
+	static thread_local uint32_t s_ThreadIndex = UINT32_MAX;
+	static thread_local const JobSystem* s_pThreadJobSystem = nullptr;
+
+	// How many times an idle worker looks for a job before going to sleep.
+	static constexpr uint32_t IDLE_SPIN_COUNT = 64;
+
+	void JobSystem::Create(uint32_t workerCount)
+	{
+		if (workerCount == AUTO_WORKER_COUNT)
+			workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		m_Stopping = false;
+		m_Deques.reserve(workerCount + 1);
+		for (uint32_t i = 0; i <= workerCount; i++)
+			m_Deques.push_back(std::make_unique<WorkStealingDeque<Job*>>(DEQUE_CAPACITY));
+
+		s_ThreadIndex = 0;
+		s_pThreadJobSystem = this;
+		PROFILE_THREAD("Main");
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t i = 1; i <= workerCount; i++)
+			m_Workers.emplace_back(&JobSystem::WorkerMain, this, i);
+	}
+
+	void JobSystem::Destroy()
+	{
+		{
+			std::lock_guard lock(m_SleepMutex);
+			m_Stopping = true;
+		}
+		m_WakeCondition.notify_all();
+		for (std::thread& rWorker : m_Workers)
+			rWorker.join();
+		m_Workers.clear();
+
+		// Run whatever's left, so no counter is left waiting forever.
+		while (TryRunJob());
+
+		m_Deques.clear();
+		s_ThreadIndex = UINT32_MAX;
+		s_pThreadJobSystem = nullptr;
+	}
+
+	void JobSystem::Schedule(JobFunction function, JobCounter* pCounter)
+	{
+		if (pCounter != nullptr)
+			pCounter->m_Value.fetch_add(1, std::memory_order_relaxed);
+		Enqueue(new Job{ std::move(function), pCounter });
+	}
+
+	void JobSystem::Schedule(JobFunction function, JobCounter& rDependency, JobCounter* pCounter)
+	{
+		if (pCounter != nullptr)
+			pCounter->m_Value.fetch_add(1, std::memory_order_relaxed);
+		Job* pJob = new Job{ std::move(function), pCounter };
+
+		// The continuation lock makes checking the dependency and registering with it atomic
+		// with respect to the dependency's last job finishing.
+		{
+			std::lock_guard lock(rDependency.m_ContinuationMutex);
+			if (!rDependency.IsDone())
+			{
+				rDependency.m_Continuations.push_back(pJob);
+				return;
+			}
+		}
+		Enqueue(pJob);
+	}
+
+	void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& crFunction, JobCounter& rCounter)
+	{
+		batchSize = std::max(batchSize, 1u);
+		for (uint32_t begin = 0; begin < count; begin += batchSize)
+		{
+			uint32_t end = std::min(begin + batchSize, count);
+			Schedule([&crFunction, begin, end]() { crFunction(begin, end); }, &rCounter);
+		}
+	}
+
+	void JobSystem::Wait(JobCounter& rCounter)
+	{
+		while (!rCounter.IsDone())
+			if (!TryRunJob())
+				std::this_thread::yield();
+
+		// The last job may still be releasing the counter.
+		std::lock_guard lock(rCounter.m_ContinuationMutex);
+	}
+
+	uint32_t JobSystem::GetCurrentThreadIndex() const noexcept
+	{
+		return s_pThreadJobSystem == this ? s_ThreadIndex : UINT32_MAX;
+	}
+
+	void JobSystem::Enqueue(Job* pJob)
+	{
+		bool queued = s_pThreadJobSystem == this && m_Deques[s_ThreadIndex]->Push(pJob);
+		if (!queued)
+		{
+			std::lock_guard lock(m_SharedQueueMutex);
+			m_SharedQueue.push_back(pJob);
+		}
+
+		// Both sides use sequentially consistent operations, so either this sees the sleeping worker,
+		// or the worker sees the queued job before it goes to sleep.
+		m_QueuedJobCount.fetch_add(1, std::memory_order_seq_cst);
+		if (m_SleepingWorkerCount.load(std::memory_order_seq_cst) > 0)
+		{
+			{ std::lock_guard lock(m_SleepMutex); }
+			m_WakeCondition.notify_one();
+		}
+	}
+
+	bool JobSystem::TryRunJob()
+	{
+		Job* pJob = FindJob();
+		if (pJob == nullptr)
+			return false;
+
+		Execute(pJob);
+		return true;
+	}
+
+	Job* JobSystem::FindJob()
+	{
+		Job* pJob = nullptr;
+		uint32_t threadIndex = GetCurrentThreadIndex();
+
+		// Own jobs first, newest first, since their data is most likely still in cache.
+		bool found = threadIndex != UINT32_MAX && m_Deques[threadIndex]->Pop(pJob);
+
+		if (!found)
+		{
+			std::lock_guard lock(m_SharedQueueMutex);
+			if (!m_SharedQueue.empty())
+			{
+				pJob = m_SharedQueue.front();
+				m_SharedQueue.pop_front();
+				found = true;
+			}
+		}
+
+		// Then steal the oldest job of another thread, starting after this one so thieves spread out.
+		// Threads outside the job system only take from the shared queue, since jobs on the deques may
+		// rely on running on one of the job system's threads, e.g. to index per-thread data.
+		uint32_t dequeCount = threadIndex != UINT32_MAX ? static_cast<uint32_t>(m_Deques.size()) : 0;
+		uint32_t start = threadIndex + 1;
+		for (uint32_t i = 0; i < dequeCount && !found; i++)
+		{
+			uint32_t victimIndex = (start + i) % dequeCount;
+			if (victimIndex != threadIndex)
+				found = m_Deques[victimIndex]->Steal(pJob);
+		}
+
+		if (!found)
+			return nullptr;
+
+		m_QueuedJobCount.fetch_sub(1, std::memory_order_relaxed);
+		return pJob;
+	}
+
+	void JobSystem::Execute(Job* pJob)
+	{
+		{
+			PROFILE_SCOPE("Job");
+			pJob->function();
+		}
+
+		JobCounter* pCounter = pJob->pCounter;
+		delete pJob;
+
+		if (pCounter == nullptr)
+			return;
+
+		// Only the decrement to zero takes the lock, everything else is a plain compare exchange.
+		uint32_t value = pCounter->m_Value.load(std::memory_order_relaxed);
+		while (value > 1)
+			if (pCounter->m_Value.compare_exchange_weak(value, value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+				return;
+
+		// Probably the counter's last job, so queue everything that was waiting on it. The lock is held across
+		// the decrement so Wait() can't return, and let the counter be destroyed, while it's still being used here.
+		std::vector<Job*> continuations;
+		{
+			std::lock_guard lock(pCounter->m_ContinuationMutex);
+			if (pCounter->m_Value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				continuations.swap(pCounter->m_Continuations);
+		}
+		for (Job* pContinuation : continuations)
+			Enqueue(pContinuation);
+	}
+
+	void JobSystem::WorkerMain(uint32_t threadIndex)
+	{
+		s_ThreadIndex = threadIndex;
+		s_pThreadJobSystem = this;
+		PROFILE_THREAD("Job Worker " + std::to_string(threadIndex));
+
+		uint32_t idleCount = 0;
+		while (!m_Stopping.load(std::memory_order_relaxed))
+		{
+			if (TryRunJob())
+			{
+				idleCount = 0;
+				continue;
+			}
+
+			if (++idleCount < IDLE_SPIN_COUNT)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock lock(m_SleepMutex);
+			m_SleepingWorkerCount.fetch_add(1, std::memory_order_seq_cst);
+			m_WakeCondition.wait(lock, [this]()
+			{
+				return m_Stopping.load(std::memory_order_relaxed) || m_QueuedJobCount.load(std::memory_order_seq_cst) > 0;
+			});
+			m_SleepingWorkerCount.fetch_sub(1, std::memory_order_relaxed);
+			idleCount = 0;
+		}
+	}
+}
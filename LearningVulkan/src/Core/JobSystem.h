@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Core/WorkStealingDeque.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core
+{
+	class JobSystem;
+	struct Job;
+
+	// Counts unfinished jobs. Every job scheduled with a counter increments it, and decrements it once done.
+	// Jobs can also depend on a counter, in which case they're only queued once it reaches zero.
+	// Only destroy a counter after JobSystem::Wait() on it has returned, not just after IsDone().
+	class JobCounter
+	{
+	public:
+		inline bool IsDone() const noexcept { return m_Value.load(std::memory_order_acquire) == 0; }
+	private:
+		friend class JobSystem;
+		std::atomic<uint32_t> m_Value = 0;
+		// Jobs waiting for this counter to reach zero.
+		std::mutex m_ContinuationMutex;
+		std::vector<Job*> m_Continuations;
+	};
+
+	struct Job
+	{
+		std::function<void()> function;
+		JobCounter* pCounter = nullptr;
+	};
+
+	// Work-stealing job scheduler. Every worker, and the thread that created the job system, has its own Chase-Lev
+	// deque: it pushes and pops its own jobs LIFO for locality, and steals FIFO from the others when it runs out.
+	// Jobs scheduled from any other thread go through a shared queue.
+	class JobSystem
+	{
+	public:
+		using JobFunction = std::function<void()>;
+		using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+		static constexpr size_t DEQUE_CAPACITY = 4096;
+		// One worker per hardware thread, besides the creating thread.
+		static constexpr uint32_t AUTO_WORKER_COUNT = UINT32_MAX;
+	public:
+		// workerCount doesn't include the creating thread, so with 0 every job runs on the creating thread in Wait().
+		void Create(uint32_t workerCount = AUTO_WORKER_COUNT);
+		void Destroy();
+
+		void Schedule(JobFunction function, JobCounter* pCounter = nullptr);
+		// The job is queued once crDependency reaches zero.
+		void Schedule(JobFunction function, JobCounter& rDependency, JobCounter* pCounter = nullptr);
+		// Splits [0, count) into jobs of up to batchSize indices each. crFunction must outlive the jobs.
+		void ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& crFunction, JobCounter& rCounter);
+
+		// Runs queued jobs on the calling thread until the counter reaches zero, instead of blocking.
+		// Threads outside the job system only run jobs from the shared queue, and otherwise just yield.
+		// Once this returns, the counter can be destroyed.
+		void Wait(JobCounter& rCounter);
+
+		// Workers plus the creating thread.
+		inline uint32_t GetThreadCount() const noexcept { return static_cast<uint32_t>(m_Deques.size()); }
+		// In [0, GetThreadCount()) on the job system's threads, 0 being the creating thread. UINT32_MAX on any other thread.
+		uint32_t GetCurrentThreadIndex() const noexcept;
+	private:
+		void Enqueue(Job* pJob);
+		bool TryRunJob();
+		Job* FindJob();
+		void Execute(Job* pJob);
+		void WorkerMain(uint32_t threadIndex);
+	private:
+		// One per thread, index 0 belongs to the creating thread.
+		std::vector<std::unique_ptr<WorkStealingDeque<Job*>>> m_Deques;
+		std::vector<std::thread> m_Workers;
+
+		// For threads without a deque, and for when a deque is full. The only jobs threads without a deque run.
+		std::mutex m_SharedQueueMutex;
+		std::deque<Job*> m_SharedQueue;
+
+		// Queued jobs that haven't been taken yet, so idle workers know when to sleep.
+		std::atomic<int64_t> m_QueuedJobCount = 0;
+		std::atomic<uint32_t> m_SleepingWorkerCount = 0;
+		std::mutex m_SleepMutex;
+		std::condition_variable m_WakeCondition;
+		std::atomic<bool> m_Stopping = false;
+	};
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <utility>
+
+namespace core
+{
+	// Fixed capacity lock-free multi-producer, single-consumer queue (after Dmitry Vyukov's bounded MPMC queue).
+	// Every slot carries a sequence number that tells producers and the consumer whose turn it is, so producers only
+	// contend on one atomic increment and never block each other while copying their item in.
+	template<typename T>
+	class MPSCRingBuffer
+	{
+	public:
+		MPSCRingBuffer(size_t capacity)
+			: m_Mask(capacity - 1), m_pSlots(std::make_unique<Slot[]>(capacity))
+		{
+			assert(std::has_single_bit(capacity) && "MPSCRingBuffer capacity must be a power of two.");
+			for (size_t i = 0; i < capacity; i++)
+				m_pSlots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	public:
+		// Any thread. Returns false, without blocking, if the buffer is full.
+		template<typename Writer>
+		bool Push(Writer&& rrWriter)
+		{
+			size_t position = m_Head.load(std::memory_order_relaxed);
+			Slot* pSlot;
+			while (true)
+			{
+				pSlot = &m_pSlots[position & m_Mask];
+				size_t sequence = pSlot->sequence.load(std::memory_order_acquire);
+				intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+				if (difference == 0)
+				{
+					if (m_Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (difference < 0)
+					return false; // Full, the consumer hasn't freed this slot yet.
+				else
+					position = m_Head.load(std::memory_order_relaxed);
+			}
+
+			std::forward<Writer>(rrWriter)(pSlot->item);
+			pSlot->sequence.store(position + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only. Returns false if the buffer is empty, or the oldest item is still being written.
+		template<typename Reader>
+		bool Pop(Reader&& rrReader)
+		{
+			Slot& rSlot = m_pSlots[m_Tail & m_Mask];
+			if (rSlot.sequence.load(std::memory_order_acquire) != m_Tail + 1)
+				return false;
+
+			std::forward<Reader>(rrReader)(rSlot.item);
+			rSlot.sequence.store(m_Tail + m_Mask + 1, std::memory_order_release);
+			m_Tail++;
+			return true;
+		}
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			T item;
+		};
+	private:
+		const size_t m_Mask;
+		std::unique_ptr<Slot[]> m_pSlots;
+		// Separate cache lines, so producers claiming slots don't keep invalidating the consumer's tail.
+		alignas(64) std::atomic<size_t> m_Head = 0;
+		alignas(64) size_t m_Tail = 0;
+	};
+}
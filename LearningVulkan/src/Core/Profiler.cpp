@@ -0,0 +1,154 @@
+#include "Core/Profiler.h"
+
+#if CONFIG_PROFILE
+
+#include <cstdio>
+#include <fstream>
+
+namespace core
+{
+	std::mutex Profiler::s_RegistryMutex;
+	std::vector<std::unique_ptr<Profiler::Track>> Profiler::s_Tracks;
+
+	// Timestamps are relative to this, so they stay small enough to print exactly in microseconds.
+	static const std::chrono::steady_clock::time_point s_Epoch = std::chrono::steady_clock::now();
+
+	Profiler::Track::~Track()
+	{
+		// Unlink the chain iteratively, so a long trace can't overflow the stack.
+		Chunk* pChunk = pFirstChunk->pNext.load(std::memory_order_relaxed);
+		while (pChunk)
+		{
+			Chunk* pNext = pChunk->pNext.load(std::memory_order_relaxed);
+			delete pChunk;
+			pChunk = pNext;
+		}
+	}
+
+	uint64_t Profiler::Now() noexcept
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_Epoch).count());
+	}
+
+	void Profiler::Record(const char* cpName, uint64_t startNanoseconds, uint64_t endNanoseconds)
+	{
+		Record(GetThreadTrack(), cpName, startNanoseconds, endNanoseconds);
+	}
+
+	void Profiler::Record(Track& rTrack, const char* cpName, uint64_t startNanoseconds, uint64_t endNanoseconds)
+	{
+		if (rTrack.eventCount >= MAX_EVENTS_PER_TRACK)
+		{
+			rTrack.droppedCount.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		Chunk* pChunk = rTrack.pCurrentChunk;
+		size_t count = pChunk->count.load(std::memory_order_relaxed);
+		if (count == CHUNK_CAPACITY)
+		{
+			Chunk* pNewChunk = new Chunk();
+			pChunk->pNext.store(pNewChunk, std::memory_order_release);
+			rTrack.pCurrentChunk = pChunk = pNewChunk;
+			count = 0;
+		}
+
+		pChunk->events[count] = { cpName, startNanoseconds, endNanoseconds - startNanoseconds };
+		pChunk->count.store(count + 1, std::memory_order_release);
+		rTrack.eventCount++;
+	}
+
+	void Profiler::SetThreadName(std::string name)
+	{
+		Track& rTrack = GetThreadTrack();
+		std::lock_guard lock(s_RegistryMutex);
+		rTrack.name = std::move(name);
+	}
+
+	Profiler::Track& Profiler::CreateTrack(std::string name)
+	{
+		Track& rTrack = RegisterTrack();
+		std::lock_guard lock(s_RegistryMutex);
+		rTrack.name = std::move(name);
+		return rTrack;
+	}
+
+	Profiler::Track& Profiler::RegisterTrack()
+	{
+		std::lock_guard lock(s_RegistryMutex);
+		Track& rTrack = *s_Tracks.emplace_back(std::make_unique<Track>());
+		rTrack.trackID = static_cast<uint32_t>(s_Tracks.size());
+		return rTrack;
+	}
+
+	Profiler::Track& Profiler::GetThreadTrack()
+	{
+		static thread_local Track* s_pThreadTrack = nullptr;
+		if (!s_pThreadTrack)
+			s_pThreadTrack = &RegisterTrack();
+		return *s_pThreadTrack;
+	}
+
+	static void WriteEscaped(std::ostream& rStream, const char* cpText)
+	{
+		for (; *cpText; cpText++)
+		{
+			if (*cpText == '"' || *cpText == '\\')
+				rStream << '\\';
+			rStream << *cpText;
+		}
+	}
+
+	bool Profiler::WriteTrace(const std::filesystem::path& crFilepath)
+	{
+		std::ofstream file(crFilepath, std::ios::binary);
+		if (!file)
+			return false;
+
+		// Complete ("X") events nest by time on each thread, so scopes show up as a flame graph without begin/end pairs.
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		char timestamps[64];
+
+		std::lock_guard lock(s_RegistryMutex);
+		for (const std::unique_ptr<Track>& crpTrack : s_Tracks)
+		{
+			if (!crpTrack->name.empty())
+			{
+				file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << crpTrack->trackID << ",\"args\":{\"name\":\"";
+				WriteEscaped(file, crpTrack->name.c_str());
+				file << "\"}}";
+				first = false;
+			}
+
+			for (const Chunk* cpChunk = crpTrack->pFirstChunk.get(); cpChunk; cpChunk = cpChunk->pNext.load(std::memory_order_acquire))
+			{
+				size_t count = cpChunk->count.load(std::memory_order_acquire);
+				for (size_t i = 0; i < count; i++)
+				{
+					const ProfileEvent& crEvent = cpChunk->events[i];
+					snprintf(timestamps, sizeof(timestamps), "\"ts\":%.3f,\"dur\":%.3f",
+						crEvent.startNanoseconds / 1000.0, crEvent.durationNanoseconds / 1000.0);
+
+					file << (first ? "" : ",\n") << "{\"name\":\"";
+					WriteEscaped(file, crEvent.cpName);
+					file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << crpTrack->trackID << ',' << timestamps << '}';
+					first = false;
+				}
+			}
+
+			uint64_t droppedCount = crpTrack->droppedCount.load(std::memory_order_relaxed);
+			if (droppedCount > 0)
+			{
+				file << (first ? "" : ",\n") << "{\"name\":\"Dropped " << droppedCount << " events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" <<
+					crpTrack->trackID << ",\"ts\":0}";
+				first = false;
+			}
+		}
+
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+}
+
+#endif // CONFIG_PROFILE
@@ -0,0 +1,118 @@
+#pragma once
+
+// Scoped CPU timing markers, only compiled in the Profile configuration. In every other configuration the macros
+// expand to nothing, so instrumentation can stay in hot paths.
+//   PROFILE_SCOPE("Name")     Times the rest of the enclosing scope. The name must be a string literal.
+//   PROFILE_FUNCTION()        PROFILE_SCOPE with the enclosing function's name.
+//   PROFILE_BEGIN(id, "Name") Like PROFILE_SCOPE, but can be ended early with PROFILE_END(id), for sequential phases
+//                             that share a scope.
+//   PROFILE_THREAD("Name")    Names the calling thread in traces.
+#if CONFIG_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace core
+{
+	struct ProfileEvent
+	{
+		const char* cpName = nullptr;
+		uint64_t startNanoseconds = 0;
+		uint64_t durationNanoseconds = 0;
+	};
+
+	// Every thread records into its own append-only track, so recording never takes a lock or contends with other
+	// threads. Tracks grow in fixed size chunks and are only read by WriteTrace(), which never blocks recording.
+	class Profiler
+	{
+	public:
+		static constexpr size_t CHUNK_CAPACITY = 4096;
+		// Past this, a track's events are dropped (about 24 MiB per track).
+		static constexpr size_t MAX_EVENTS_PER_TRACK = 1 << 20;
+	public:
+		struct Track;
+	public:
+		static uint64_t Now() noexcept;
+		static void Record(const char* cpName, uint64_t startNanoseconds, uint64_t endNanoseconds);
+		static void SetThreadName(std::string name);
+
+		// A named timeline that isn't a thread, e.g. a GPU queue. Only one thread at a time may record into a track.
+		static Track& CreateTrack(std::string name);
+		static void Record(Track& rTrack, const char* cpName, uint64_t startNanoseconds, uint64_t endNanoseconds);
+
+		// Writes every event recorded so far in Chrome's trace event format, which Perfetto and chrome://tracing open.
+		// Can be called from any thread at any time; events still being recorded are just left out.
+		static bool WriteTrace(const std::filesystem::path& crFilepath);
+	private:
+		struct Chunk
+		{
+			ProfileEvent events[CHUNK_CAPACITY];
+			// Published with release after each event is written, so readers only see complete events.
+			std::atomic<size_t> count = 0;
+			std::atomic<Chunk*> pNext = nullptr;
+		};
+	public:
+		struct Track
+		{
+			uint32_t trackID = 0;
+			std::string name; // Guarded by the registry mutex.
+			std::unique_ptr<Chunk> pFirstChunk = std::make_unique<Chunk>();
+			Chunk* pCurrentChunk = pFirstChunk.get(); // Owner only.
+			size_t eventCount = 0; // Owner only.
+			std::atomic<uint64_t> droppedCount = 0;
+
+			~Track();
+		};
+	private:
+		static Track& RegisterTrack();
+		static Track& GetThreadTrack();
+	private:
+		// Tracks outlive their threads, so a trace still has the events of workers that have already exited.
+		static std::mutex s_RegistryMutex;
+		static std::vector<std::unique_ptr<Track>> s_Tracks;
+	};
+
+	class ProfileScope
+	{
+	public:
+		inline ProfileScope(const char* cpName) noexcept : m_cpName(cpName), m_StartNanoseconds(Profiler::Now()) {}
+		inline ~ProfileScope() { End(); }
+
+		inline void End()
+		{
+			if (m_cpName)
+				Profiler::Record(m_cpName, m_StartNanoseconds, Profiler::Now());
+			m_cpName = nullptr;
+		}
+
+		ProfileScope(const ProfileScope&) = delete;
+		ProfileScope& operator=(const ProfileScope&) = delete;
+	private:
+		const char* m_cpName;
+		uint64_t m_StartNanoseconds;
+	};
+}
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+#define PROFILE_SCOPE(name) ::core::ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_BEGIN(id, name) ::core::ProfileScope id(name)
+#define PROFILE_END(id) id.End()
+#define PROFILE_THREAD(name) ::core::Profiler::SetThreadName(name)
+
+#else // !CONFIG_PROFILE
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_BEGIN(id, name)
+#define PROFILE_END(id)
+#define PROFILE_THREAD(name)
+
+#endif // CONFIG_PROFILE
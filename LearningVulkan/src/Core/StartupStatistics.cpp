@@ -0,0 +1,93 @@
+#include "Core/StartupStatistics.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace core
+{
+	void StartupStatistics::Begin()
+	{
+		std::lock_guard lock(m_Mutex);
+		m_StartTime = Clock::now();
+		m_Phases.clear();
+		m_TimeToFirstFrameMilliseconds = 0.0;
+	}
+
+	void StartupStatistics::RecordPhase(const char* cpName, Clock::time_point startTime, Clock::time_point endTime)
+	{
+		std::lock_guard lock(m_Mutex);
+		StartupPhase& rPhase = m_Phases.emplace_back();
+		rPhase.cpName = cpName;
+		rPhase.startMilliseconds = ToMilliseconds(startTime);
+		rPhase.durationMilliseconds = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+	}
+
+	void StartupStatistics::RecordFirstFrame()
+	{
+		std::lock_guard lock(m_Mutex);
+		m_TimeToFirstFrameMilliseconds = ToMilliseconds(Clock::now());
+	}
+
+	std::vector<StartupPhase> StartupStatistics::GetPhases() const
+	{
+		std::vector<StartupPhase> phases;
+		{
+			std::lock_guard lock(m_Mutex);
+			phases = m_Phases;
+		}
+
+		std::stable_sort(phases.begin(), phases.end(), [](const StartupPhase& crA, const StartupPhase& crB)
+		{
+			return crA.startMilliseconds < crB.startMilliseconds;
+		});
+		return phases;
+	}
+
+	double StartupStatistics::GetTimeToFirstFrameMilliseconds() const
+	{
+		std::lock_guard lock(m_Mutex);
+		return m_TimeToFirstFrameMilliseconds;
+	}
+
+	void StartupStatistics::Print(std::ostream& rStream) const
+	{
+		char line[128];
+		std::snprintf(line, sizeof(line), "%-32s %10s %10s\n", "startup phase (ms)", "start", "duration");
+		rStream << line;
+		for (const StartupPhase& crPhase : GetPhases())
+		{
+			std::snprintf(line, sizeof(line), "%-32s %10.3f %10.3f\n", crPhase.cpName, crPhase.startMilliseconds, crPhase.durationMilliseconds);
+			rStream << line;
+		}
+
+		double timeToFirstFrameMilliseconds = GetTimeToFirstFrameMilliseconds();
+		if (timeToFirstFrameMilliseconds > 0.0)
+		{
+			std::snprintf(line, sizeof(line), "%-32s %10.3f\n", "time to first frame", timeToFirstFrameMilliseconds);
+			rStream << line;
+		}
+	}
+
+	double StartupStatistics::ToMilliseconds(Clock::time_point time) const
+	{
+		return std::chrono::duration<double, std::milli>(time - m_StartTime).count();
+	}
+
+	StartupPhaseScope::StartupPhaseScope(StartupStatistics& rStatistics, const char* cpName)
+		: m_rStatistics(rStatistics), m_cpName(cpName), m_StartTime(StartupStatistics::Clock::now())
+#if CONFIG_PROFILE
+		, m_ProfileStartNanoseconds(Profiler::Now())
+#endif
+	{}
+
+	void StartupPhaseScope::End()
+	{
+		if (!m_cpName)
+			return;
+
+		m_rStatistics.RecordPhase(m_cpName, m_StartTime, StartupStatistics::Clock::now());
+#if CONFIG_PROFILE
+		Profiler::Record(m_cpName, m_ProfileStartNanoseconds, Profiler::Now());
+#endif
+		m_cpName = nullptr;
+	}
+}
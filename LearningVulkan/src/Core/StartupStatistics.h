@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Core/Profiler.h"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace core
+{
+	struct StartupPhase
+	{
+		const char* cpName = nullptr;
+		// Relative to when startup began, so phases that ran in parallel overlap.
+		double startMilliseconds = 0.0;
+		double durationMilliseconds = 0.0;
+	};
+
+	// Breaks startup down into phases, some of which run in parallel as jobs, and measures the time to first frame.
+	// Unlike the CPU profiler, this is compiled in every configuration. Thread safe.
+	class StartupStatistics
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+	public:
+		void Begin();
+		// cpName must be a string literal.
+		void RecordPhase(const char* cpName, Clock::time_point startTime, Clock::time_point endTime);
+		void RecordFirstFrame();
+
+		// Sorted by start time.
+		std::vector<StartupPhase> GetPhases() const;
+		// 0 until the first frame has been submitted.
+		double GetTimeToFirstFrameMilliseconds() const;
+		void Print(std::ostream& rStream) const;
+	private:
+		double ToMilliseconds(Clock::time_point time) const;
+	private:
+		Clock::time_point m_StartTime;
+		mutable std::mutex m_Mutex;
+		std::vector<StartupPhase> m_Phases;
+		double m_TimeToFirstFrameMilliseconds = 0.0;
+	};
+
+	// Records the rest of the enclosing scope as a startup phase, and in the Profile configuration as a trace event too.
+	class StartupPhaseScope
+	{
+	public:
+		StartupPhaseScope(StartupStatistics& rStatistics, const char* cpName);
+		inline ~StartupPhaseScope() { End(); }
+
+		// Ends the phase early, for sequential phases that share a scope.
+		void End();
+
+		StartupPhaseScope(const StartupPhaseScope&) = delete;
+		StartupPhaseScope& operator=(const StartupPhaseScope&) = delete;
+	private:
+		StartupStatistics& m_rStatistics;
+		const char* m_cpName;
+		StartupStatistics::Clock::time_point m_StartTime;
+#if CONFIG_PROFILE
+		uint64_t m_ProfileStartNanoseconds;
+#endif
+	};
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <assert.h>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <type_traits>
+
+namespace core
+{
+	// Fixed capacity Chase-Lev deque (Le, Pop, Cohen and Zappa Nardelli, "Correct and Efficient Work-Stealing for Weak
+	// Memory Models"). The owning thread pushes and pops at the bottom, any other thread steals from the top.
+	template<typename T>
+	class WorkStealingDeque
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "WorkStealingDeque elements must be trivially copyable.");
+	public:
+		WorkStealingDeque(size_t capacity)
+			: m_Mask(static_cast<int64_t>(capacity) - 1), m_pBuffer(std::make_unique<std::atomic<T>[]>(capacity))
+		{
+			assert(std::has_single_bit(capacity) && "WorkStealingDeque capacity must be a power of two.");
+		}
+	public:
+		// Owner only. Returns false if the deque is full.
+		bool Push(T item) noexcept
+		{
+			int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+			int64_t top = m_Top.load(std::memory_order_acquire);
+			if (bottom - top > m_Mask)
+				return false;
+
+			m_pBuffer[bottom & m_Mask].store(item, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		// Owner only.
+		bool Pop(T& rItem) noexcept
+		{
+			int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+			m_Bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_Top.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				// Empty.
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			rItem = m_pBuffer[bottom & m_Mask].load(std::memory_order_relaxed);
+			if (top == bottom)
+			{
+				// Last item, race the thieves for it.
+				bool won = m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		// Any thread.
+		bool Steal(T& rItem) noexcept
+		{
+			int64_t top = m_Top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+			if (top >= bottom)
+				return false;
+
+			rItem = m_pBuffer[top & m_Mask].load(std::memory_order_relaxed);
+			return m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+	private:
+		// Top and bottom on separate cache lines, since thieves hammer one and the owner the other.
+		alignas(64) std::atomic<int64_t> m_Top = 0;
+		alignas(64) std::atomic<int64_t> m_Bottom = 0;
+		int64_t m_Mask;
+		std::unique_ptr<std::atomic<T>[]> m_pBuffer;
+	};
+}
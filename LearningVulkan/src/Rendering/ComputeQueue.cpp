@@ -0,0 +1,112 @@
+#include "Rendering/ComputeQueue.h"
+#include <assert.h>
+
+namespace rendering
+{
+	void ComputeQueue::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, QueueTimeline& rTimeline)
+	{
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_pTimeline = &rTimeline;
+	}
+
+	void ComputeQueue::Destroy()
+	{
+		Wait(GetLastSubmittedValue());
+		RecycleFinishedSubmissions();
+		assert(m_PendingSubmissions.empty() && "Compute submissions are still in flight.");
+
+		for (Submission& rSubmission : m_FreeSubmissions)
+			m_cpDispatch->vkDestroyCommandPool(m_pDevice, rSubmission.pCommandPool, m_cpDispatch->cpAllocationCallbacks);
+		m_FreeSubmissions.clear();
+	}
+
+	uint64_t ComputeQueue::Submit(const RecordFunction& crRecord, std::span<const TimelineWait> waits)
+	{
+		std::lock_guard lock(m_Mutex);
+		RecycleFinishedSubmissions();
+
+		Submission submission = AcquireSubmission();
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo{};
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		VkResult result = m_cpDispatch->vkBeginCommandBuffer(submission.pCommandBuffer, &commandBufferBeginInfo);
+		assert(result == VK_SUCCESS && "Failed to begin compute command buffer.");
+		crRecord(submission.pCommandBuffer);
+		result = m_cpDispatch->vkEndCommandBuffer(submission.pCommandBuffer);
+		assert(result == VK_SUCCESS && "Failed to end compute command buffer.");
+
+		std::vector<VkSemaphoreSubmitInfo> waitInfos;
+		waitInfos.reserve(waits.size());
+		for (const TimelineWait& crWait : waits)
+			waitInfos.push_back(QueueTimeline::GetWaitInfo(crWait));
+
+		VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
+		commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferSubmitInfo.commandBuffer = submission.pCommandBuffer;
+		submission.timelineValue = m_pTimeline->Enqueue({ &commandBufferSubmitInfo, 1 }, waitInfos);
+
+		m_PendingSubmissions.push_back(submission);
+		return submission.timelineValue;
+	}
+
+	void ComputeQueue::Wait(uint64_t value)
+	{
+		m_pTimeline->Wait(value);
+	}
+
+	bool ComputeQueue::IsComplete(uint64_t value)
+	{
+		return m_pTimeline->IsComplete(value);
+	}
+
+	ComputeQueue::Submission ComputeQueue::AcquireSubmission()
+	{
+		if (!m_FreeSubmissions.empty())
+		{
+			Submission submission = m_FreeSubmissions.back();
+			m_FreeSubmissions.pop_back();
+			return submission;
+		}
+
+		Submission submission;
+
+		VkCommandPoolCreateInfo commandPoolCreateInfo{};
+		commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		commandPoolCreateInfo.queueFamilyIndex = m_pTimeline->GetQueueFamilyIndex();
+
+		VkResult result = m_cpDispatch->vkCreateCommandPool(m_pDevice, &commandPoolCreateInfo, m_cpDispatch->cpAllocationCallbacks, &submission.pCommandPool);
+		assert(result == VK_SUCCESS && "Failed to create compute command pool.");
+
+		VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+		commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		commandBufferAllocateInfo.commandPool = submission.pCommandPool;
+		commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		commandBufferAllocateInfo.commandBufferCount = 1;
+
+		result = m_cpDispatch->vkAllocateCommandBuffers(m_pDevice, &commandBufferAllocateInfo, &submission.pCommandBuffer);
+		assert(result == VK_SUCCESS && "Failed to allocate compute command buffer.");
+		return submission;
+	}
+
+	void ComputeQueue::RecycleFinishedSubmissions()
+	{
+		if (m_PendingSubmissions.empty())
+			return;
+
+		uint64_t completedValue = m_pTimeline->GetCompletedValue();
+		while (!m_PendingSubmissions.empty() && m_PendingSubmissions.front().timelineValue <= completedValue)
+		{
+			Submission& rSubmission = m_PendingSubmissions.front();
+
+			VkResult result = m_cpDispatch->vkResetCommandPool(m_pDevice, rSubmission.pCommandPool, 0);
+			assert(result == VK_SUCCESS && "Failed to reset compute command pool.");
+
+			m_FreeSubmissions.push_back(rSubmission);
+			m_PendingSubmissions.pop_front();
+		}
+	}
+}
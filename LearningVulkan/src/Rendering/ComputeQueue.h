@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Rendering/QueueTimeline.h"
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace rendering
+{
+	// Submits compute work (culling, particles, simulations) to the async compute queue, so it overlaps with graphics.
+	// Every submission signals the compute timeline with the value Submit() returns. Other queues wait on that
+	// value on the GPU (see Application::AddFrameWait()), instead of the CPU waiting for the whole queue to go idle.
+	//
+	// If the compute and graphics queue families differ, shared resources must be created with
+	// VK_SHARING_MODE_CONCURRENT across both families, since no queue family ownership transfers are done.
+	// All functions are thread safe.
+	class ComputeQueue
+	{
+	public:
+		using RecordFunction = std::function<void(VkCommandBuffer pCommandBuffer)>;
+	public:
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, QueueTimeline& rTimeline);
+		void Destroy();
+
+		// Records crRecord into a fresh command buffer, to run once every wait has been reached. It's batched with the
+		// queue's other submissions, which the application flushes every frame, or Wait() does if it has to.
+		// Returns the timeline value that'll be signaled once the work is done.
+		uint64_t Submit(const RecordFunction& crRecord, std::span<const TimelineWait> waits = {});
+
+		// Blocks until the given timeline value has been signaled.
+		void Wait(uint64_t value);
+		bool IsComplete(uint64_t value);
+
+		inline VkSemaphore GetTimelineSemaphore() const noexcept { return m_pTimeline->GetSemaphore(); }
+		inline uint32_t GetQueueFamilyIndex() const noexcept { return m_pTimeline->GetQueueFamilyIndex(); }
+		inline uint64_t GetLastSubmittedValue() const noexcept { return m_pTimeline->GetLastSubmittedValue(); }
+	private:
+		struct Submission
+		{
+			VkCommandPool pCommandPool = VK_NULL_HANDLE;
+			VkCommandBuffer pCommandBuffer = VK_NULL_HANDLE;
+			uint64_t timelineValue = 0;
+		};
+	private:
+		Submission AcquireSubmission();
+		void RecycleFinishedSubmissions();
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		QueueTimeline* m_pTimeline = nullptr;
+
+		std::deque<Submission> m_PendingSubmissions;
+		std::vector<Submission> m_FreeSubmissions;
+
+		std::mutex m_Mutex;
+	};
+}
@@ -0,0 +1,160 @@
+#include "Rendering/DebugMessageSink.h"
+#include <assert.h>
+#include <cstring>
+#include <iostream>
+
+namespace rendering
+{
+	static const char* GetSeverityName(VkDebugUtilsMessageSeverityFlagBitsEXT severity)
+	{
+		switch (severity)
+		{
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT: return "trace";
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT: return "info";
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT: return "warning";
+			case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT: return "error";
+			default: return "unknown";
+		}
+	}
+
+	// FNV-1a, to tell apart messages that don't have an id.
+	static uint64_t HashText(const char* cpText)
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+		for (; *cpText; cpText++)
+			hash = (hash ^ static_cast<unsigned char>(*cpText)) * 0x100000001b3ull;
+		return hash;
+	}
+
+	static void CopyTruncated(char* pDestination, size_t capacity, const char* cpSource)
+	{
+		if (!cpSource)
+		{
+			pDestination[0] = '\0';
+			return;
+		}
+		size_t length = strnlen(cpSource, capacity - 1);
+		memcpy(pDestination, cpSource, length);
+		pDestination[length] = '\0';
+	}
+
+	void DebugMessageSink::Create()
+	{
+		m_pRing = std::make_unique<core::MPSCRingBuffer<Message>>(RING_CAPACITY);
+		m_Running = true;
+		m_Thread = std::thread(&DebugMessageSink::ThreadMain, this);
+	}
+
+	void DebugMessageSink::Destroy()
+	{
+		{
+			std::lock_guard lock(m_WakeMutex);
+			m_Running = false;
+		}
+		m_WakeCondition.notify_one();
+		m_Thread.join();
+
+		auto now = std::chrono::steady_clock::now();
+		Drain(now);
+		PrintSuppressed(now, true);
+		m_History.clear();
+		m_pRing.reset();
+	}
+
+	VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessageSink::Callback
+	(
+		VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+		VkDebugUtilsMessageTypeFlagsEXT type,
+		const VkDebugUtilsMessengerCallbackDataEXT* cpCallbackData,
+		void* pUserData
+	)
+	{
+		static_cast<DebugMessageSink*>(pUserData)->Push(severity, cpCallbackData);
+		return VK_FALSE;
+	}
+
+	void DebugMessageSink::Push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* cpCallbackData)
+	{
+		bool pushed = m_pRing->Push([severity, cpCallbackData](Message& rMessage)
+		{
+			rMessage.severity = severity;
+			rMessage.key = cpCallbackData->messageIdNumber != 0 ? static_cast<uint32_t>(cpCallbackData->messageIdNumber) : HashText(cpCallbackData->pMessage);
+			CopyTruncated(rMessage.idName, MAX_ID_NAME_LENGTH, cpCallbackData->pMessageIdName);
+			CopyTruncated(rMessage.text, MAX_MESSAGE_LENGTH, cpCallbackData->pMessage);
+		});
+
+		if (!pushed)
+			m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+		else if (severity == VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+			m_WakeCondition.notify_one(); // Errors usually come right before an assert, so get them out now.
+	}
+
+	void DebugMessageSink::ThreadMain()
+	{
+		std::unique_lock lock(m_WakeMutex);
+		while (m_Running)
+		{
+			m_WakeCondition.wait_for(lock, FLUSH_INTERVAL);
+			lock.unlock();
+
+			auto now = std::chrono::steady_clock::now();
+			Drain(now);
+			PrintSuppressed(now, false);
+
+			lock.lock();
+		}
+	}
+
+	void DebugMessageSink::Drain(std::chrono::steady_clock::time_point now)
+	{
+		while (m_pRing->Pop([this, now](const Message& crMessage) { Record(crMessage, now); }));
+
+		uint64_t droppedCount = m_DroppedCount.load(std::memory_order_relaxed);
+		if (droppedCount != m_ReportedDroppedCount)
+		{
+			std::cerr << "Vulkan Debug: dropped " << droppedCount - m_ReportedDroppedCount << " messages, the message ring buffer was full.\n";
+			m_ReportedDroppedCount = droppedCount;
+		}
+	}
+
+	void DebugMessageSink::Record(const Message& crMessage, std::chrono::steady_clock::time_point now)
+	{
+		auto [it, inserted] = m_History.try_emplace(crMessage.key);
+		MessageHistory& rHistory = it->second;
+		rHistory.totalCount++;
+
+		if (!inserted && now - rHistory.lastPrintTime < REPEAT_INTERVAL)
+		{
+			rHistory.suppressedCount++;
+			return;
+		}
+
+		if (inserted)
+		{
+			rHistory.severity = crMessage.severity;
+			rHistory.label = crMessage.idName[0] ? crMessage.idName : std::string(crMessage.text, strnlen(crMessage.text, 80));
+		}
+
+		std::cerr << "Vulkan Debug [" << GetSeverityName(crMessage.severity) << "]";
+		if (rHistory.suppressedCount > 0)
+			std::cerr << " (repeated " << rHistory.suppressedCount << " times since last shown)";
+		std::cerr << ": " << crMessage.text << '\n';
+
+		rHistory.suppressedCount = 0;
+		rHistory.lastPrintTime = now;
+	}
+
+	void DebugMessageSink::PrintSuppressed(std::chrono::steady_clock::time_point now, bool force)
+	{
+		for (auto& [key, rHistory] : m_History)
+		{
+			if (rHistory.suppressedCount == 0 || (!force && now - rHistory.lastPrintTime < REPEAT_INTERVAL))
+				continue;
+
+			std::cerr << "Vulkan Debug [" << GetSeverityName(rHistory.severity) << "]: \"" << rHistory.label << "\" repeated " <<
+				rHistory.suppressedCount << " more times (" << rHistory.totalCount << " total).\n";
+			rHistory.suppressedCount = 0;
+			rHistory.lastPrintTime = now;
+		}
+	}
+}
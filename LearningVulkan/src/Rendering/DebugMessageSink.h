@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Core/MPSCRingBuffer.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+namespace rendering
+{
+	// Receives debug utils messages without doing any I/O on the driver's call stack. The callback only copies the
+	// message into a lock-free ring buffer; a background thread deduplicates messages by id, rate limits repeats and
+	// writes them to std::cerr with their severity and how often they were repeated.
+	// Must outlive the instance, since messages are also reported during vkCreateInstance and vkDestroyInstance.
+	class DebugMessageSink
+	{
+	public:
+		static constexpr size_t RING_CAPACITY = 1024;
+		// Longer messages are truncated.
+		static constexpr size_t MAX_MESSAGE_LENGTH = 1024;
+		static constexpr size_t MAX_ID_NAME_LENGTH = 128;
+		// A message id is printed at most once per interval, later repeats are only counted until then.
+		static constexpr std::chrono::milliseconds REPEAT_INTERVAL{ 1000 };
+		static constexpr std::chrono::milliseconds FLUSH_INTERVAL{ 50 };
+	public:
+		void Create();
+		// Writes out everything still queued, along with the repeat counts of suppressed messages.
+		void Destroy();
+
+		// Use with this sink as the messenger's pUserData.
+		static VKAPI_ATTR VkBool32 VKAPI_CALL Callback
+		(
+			VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+			VkDebugUtilsMessageTypeFlagsEXT type,
+			const VkDebugUtilsMessengerCallbackDataEXT* cpCallbackData,
+			void* pUserData
+		);
+	private:
+		struct Message
+		{
+			VkDebugUtilsMessageSeverityFlagBitsEXT severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+			// messageIdNumber, or a hash of the text for messages without an id.
+			uint64_t key = 0;
+			char idName[MAX_ID_NAME_LENGTH]{};
+			char text[MAX_MESSAGE_LENGTH]{};
+		};
+
+		struct MessageHistory
+		{
+			VkDebugUtilsMessageSeverityFlagBitsEXT severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+			// What repeat counts are reported under: the id name, or the start of the text for messages without one.
+			std::string label;
+			uint64_t totalCount = 0;
+			// Repeats since the message was last printed.
+			uint64_t suppressedCount = 0;
+			std::chrono::steady_clock::time_point lastPrintTime;
+		};
+	private:
+		void Push(VkDebugUtilsMessageSeverityFlagBitsEXT severity, const VkDebugUtilsMessengerCallbackDataEXT* cpCallbackData);
+		void ThreadMain();
+		void Drain(std::chrono::steady_clock::time_point now);
+		void Record(const Message& crMessage, std::chrono::steady_clock::time_point now);
+		// Reports repeats of messages whose interval has passed, or of every message if force is set.
+		void PrintSuppressed(std::chrono::steady_clock::time_point now, bool force);
+	private:
+		std::unique_ptr<core::MPSCRingBuffer<Message>> m_pRing;
+		std::atomic<uint64_t> m_DroppedCount = 0;
+
+		std::thread m_Thread;
+		std::mutex m_WakeMutex;
+		std::condition_variable m_WakeCondition;
+		bool m_Running = false;
+
+		// Only touched by the background thread (and Destroy() once it has joined).
+		std::unordered_map<uint64_t, MessageHistory> m_History;
+		uint64_t m_ReportedDroppedCount = 0;
+	};
+}
@@ -0,0 +1,139 @@
+#include "Rendering/DeletionQueue.h"
+#include "Core/Profiler.h"
+#include <algorithm>
+#include <iterator>
+
+namespace rendering
+{
+	void DeletionQueue::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, DeviceAllocator& rAllocator)
+	{
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_pAllocator = &rAllocator;
+	}
+
+	void DeletionQueue::Destroy()
+	{
+		// Callbacks may retire more, so keep going until nothing's left.
+		std::vector<Entry> entries;
+		while (true)
+		{
+			{
+				std::lock_guard lock(m_Mutex);
+				entries.swap(m_Entries);
+			}
+			if (entries.empty())
+				break;
+
+			for (Entry& rEntry : entries)
+				DestroyEntry(rEntry);
+			entries.clear();
+		}
+	}
+
+	void DeletionQueue::Retire(const TimelinePoint& crPoint, VkBuffer pBuffer)
+	{
+		Push({ crPoint, EntryType::Buffer, pBuffer });
+	}
+
+	void DeletionQueue::Retire(const TimelinePoint& crPoint, VkImage pImage)
+	{
+		Push({ crPoint, EntryType::Image, pImage });
+	}
+
+	void DeletionQueue::Retire(const TimelinePoint& crPoint, VkImageView pImageView)
+	{
+		Push({ crPoint, EntryType::ImageView, pImageView });
+	}
+
+	void DeletionQueue::Retire(const TimelinePoint& crPoint, VkSwapchainKHR pSwapChain)
+	{
+		Push({ crPoint, EntryType::SwapChain, pSwapChain });
+	}
+
+	void DeletionQueue::Retire(const TimelinePoint& crPoint, VkSemaphore pSemaphore)
+	{
+		Push({ crPoint, EntryType::Semaphore, pSemaphore });
+	}
+
+	void DeletionQueue::Retire(const TimelinePoint& crPoint, const Allocation& crAllocation)
+	{
+		Push({ crPoint, EntryType::Allocation, nullptr, crAllocation });
+	}
+
+	void DeletionQueue::Retire(const TimelinePoint& crPoint, Callback callback)
+	{
+		Push({ crPoint, EntryType::Callback, nullptr, {}, std::move(callback) });
+	}
+
+	void DeletionQueue::Collect()
+	{
+		PROFILE_FUNCTION();
+
+		{
+			std::lock_guard lock(m_Mutex);
+			if (m_Entries.empty())
+				return;
+
+			// Each semaphore is only queried once, no matter how many entries are waiting on it.
+			m_CompletedValues.clear();
+			auto isReady = [this](const Entry& crEntry)
+			{
+				auto it = std::find_if(m_CompletedValues.begin(), m_CompletedValues.end(),
+					[&crEntry](const TimelinePoint& crCompleted) { return crCompleted.pSemaphore == crEntry.point.pSemaphore; });
+				if (it == m_CompletedValues.end())
+					it = m_CompletedValues.insert(it, { crEntry.point.pSemaphore, GetTimelineSemaphoreValue(*m_cpDispatch, m_pDevice, crEntry.point.pSemaphore) });
+				return it->value >= crEntry.point.value;
+			};
+
+			auto readyBegin = std::stable_partition(m_Entries.begin(), m_Entries.end(), [&isReady](const Entry& crEntry) { return !isReady(crEntry); });
+			std::move(readyBegin, m_Entries.end(), std::back_inserter(m_ReadyEntries));
+			m_Entries.erase(readyBegin, m_Entries.end());
+		}
+
+		// Destroyed outside the lock, so callbacks can retire more.
+		for (Entry& rEntry : m_ReadyEntries)
+			DestroyEntry(rEntry);
+		m_ReadyEntries.clear();
+	}
+
+	size_t DeletionQueue::GetPendingCount() const
+	{
+		std::lock_guard lock(m_Mutex);
+		return m_Entries.size();
+	}
+
+	void DeletionQueue::Push(Entry&& rrEntry)
+	{
+		std::lock_guard lock(m_Mutex);
+		m_Entries.push_back(std::move(rrEntry));
+	}
+
+	void DeletionQueue::DestroyEntry(Entry& rEntry)
+	{
+		switch (rEntry.type)
+		{
+			case EntryType::Buffer:
+				m_cpDispatch->vkDestroyBuffer(m_pDevice, static_cast<VkBuffer>(rEntry.pHandle), m_cpDispatch->cpAllocationCallbacks);
+				break;
+			case EntryType::Image:
+				m_cpDispatch->vkDestroyImage(m_pDevice, static_cast<VkImage>(rEntry.pHandle), m_cpDispatch->cpAllocationCallbacks);
+				break;
+			case EntryType::ImageView:
+				m_cpDispatch->vkDestroyImageView(m_pDevice, static_cast<VkImageView>(rEntry.pHandle), m_cpDispatch->cpAllocationCallbacks);
+				break;
+			case EntryType::SwapChain:
+				m_cpDispatch->vkDestroySwapchainKHR(m_pDevice, static_cast<VkSwapchainKHR>(rEntry.pHandle), m_cpDispatch->cpAllocationCallbacks);
+				break;
+			case EntryType::Semaphore:
+				m_cpDispatch->vkDestroySemaphore(m_pDevice, static_cast<VkSemaphore>(rEntry.pHandle), m_cpDispatch->cpAllocationCallbacks);
+				break;
+			case EntryType::Allocation:
+				m_pAllocator->Free(rEntry.allocation);
+				break;
+			case EntryType::Callback:
+				rEntry.callback();
+				break;
+		}
+	}
+}
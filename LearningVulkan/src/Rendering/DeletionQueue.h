@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Rendering/DeviceAllocator.h"
+#include "Rendering/Timeline.h"
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace rendering
+{
+	// Defers destroying resources until the GPU is done with them, so nothing has to wait for the device to go idle
+	// while frames are in flight. Each retired resource is tagged with the timeline point of the last submission that
+	// uses it, and is destroyed by the first Collect() after the semaphore reaches that value.
+	// Retire() is thread safe. Collect() must only be called from one thread at a time.
+	class DeletionQueue
+	{
+	public:
+		// For anything that isn't a Vulkan handle, e.g. returning a slot in a shared buffer to its free list.
+		using Callback = std::function<void()>;
+	public:
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, DeviceAllocator& rAllocator);
+		// Destroys everything that's left, whether or not the GPU is done with it, so only call it once the device is idle.
+		void Destroy();
+
+		void Retire(const TimelinePoint& crPoint, VkBuffer pBuffer);
+		void Retire(const TimelinePoint& crPoint, VkImage pImage);
+		void Retire(const TimelinePoint& crPoint, VkImageView pImageView);
+		void Retire(const TimelinePoint& crPoint, VkSwapchainKHR pSwapChain);
+		void Retire(const TimelinePoint& crPoint, VkSemaphore pSemaphore);
+		void Retire(const TimelinePoint& crPoint, const Allocation& crAllocation);
+		void Retire(const TimelinePoint& crPoint, Callback callback);
+
+		// Destroys everything whose timeline point has been reached. Never blocks on the GPU.
+		void Collect();
+
+		size_t GetPendingCount() const;
+	private:
+		enum class EntryType : uint8_t
+		{
+			Buffer,
+			Image,
+			ImageView,
+			SwapChain,
+			Semaphore,
+			Allocation,
+			Callback,
+		};
+
+		struct Entry
+		{
+			TimelinePoint point;
+			EntryType type = EntryType::Buffer;
+			// Non-dispatchable handles are all pointers on 64-bit.
+			void* pHandle = nullptr;
+			Allocation allocation;
+			Callback callback;
+		};
+	private:
+		void Push(Entry&& rrEntry);
+		void DestroyEntry(Entry& rEntry);
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		DeviceAllocator* m_pAllocator = nullptr;
+
+		mutable std::mutex m_Mutex;
+		std::vector<Entry> m_Entries;
+		// Only touched by Collect(), kept around so collecting doesn't allocate.
+		std::vector<Entry> m_ReadyEntries;
+		std::vector<TimelinePoint> m_CompletedValues;
+	};
+}
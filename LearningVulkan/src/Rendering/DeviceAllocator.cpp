@@ -0,0 +1,399 @@
+#include "Rendering/DeviceAllocator.h"
+#include "Rendering/Memory.h"
+#include <assert.h>
+#include <algorithm>
+#include <bit>
+
+namespace rendering
+{
+	void DeviceAllocator::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, const VkPhysicalDeviceProperties& crPhysicalDeviceProperties,
+		const VkPhysicalDeviceMemoryProperties& crMemoryProperties, VkDeviceSize blockSize)
+	{
+		assert(std::has_single_bit(blockSize) && blockSize >= MIN_ALLOCATION_SIZE && "Block size must be a power of two.");
+
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_MemoryProperties = crMemoryProperties;
+		m_NonCoherentAtomSize = crPhysicalDeviceProperties.limits.nonCoherentAtomSize;
+		m_MaxMemoryAllocationCount = crPhysicalDeviceProperties.limits.maxMemoryAllocationCount;
+
+		// Small heaps (e.g. the 256 MiB device local and host visible one) get smaller blocks, so one block can't take up most of the heap.
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[i].heapIndex].size;
+			VkDeviceSize typeBlockSize = std::min(blockSize, std::bit_floor(std::max<VkDeviceSize>(heapSize / 8, MIN_ALLOCATION_SIZE)));
+			m_BlockSizes[i] = typeBlockSize;
+			m_MaxOrders[i] = static_cast<uint32_t>(std::countr_zero(typeBlockSize / MIN_ALLOCATION_SIZE));
+		}
+	}
+
+	void DeviceAllocator::Destroy()
+	{
+		for (std::array<Pool, 2>& rPools : m_Pools)
+		{
+			for (Pool& rPool : rPools)
+			{
+				for (std::unique_ptr<Block>& rpBlock : rPool.blocks)
+				{
+					assert(rpBlock->allocationCount == 0 && "Device memory leaked.");
+					DestroyBlock(rpBlock.get());
+				}
+				rPool.blocks.clear();
+			}
+		}
+		assert(m_DedicatedAllocationCount == 0 && "Dedicated device memory leaked.");
+	}
+
+	Allocation DeviceAllocator::AllocateBuffer(VkBuffer pBuffer, const AllocationCreateInfo& crCreateInfo)
+	{
+		VkMemoryDedicatedRequirements memoryDedicatedRequirements{};
+		memoryDedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+		VkMemoryRequirements2 memoryRequirements2{};
+		memoryRequirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		memoryRequirements2.pNext = &memoryDedicatedRequirements;
+
+		VkBufferMemoryRequirementsInfo2 bufferMemoryRequirementsInfo2{};
+		bufferMemoryRequirementsInfo2.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+		bufferMemoryRequirementsInfo2.buffer = pBuffer;
+		m_cpDispatch->vkGetBufferMemoryRequirements2(m_pDevice, &bufferMemoryRequirementsInfo2, &memoryRequirements2);
+
+		Allocation allocation;
+		const VkMemoryRequirements& crMemoryRequirements = memoryRequirements2.memoryRequirements;
+		if (crCreateInfo.dedicated || memoryDedicatedRequirements.prefersDedicatedAllocation || memoryDedicatedRequirements.requiresDedicatedAllocation)
+		{
+			uint32_t memoryTypeIndex = FindMemoryTypeIndex(m_MemoryProperties, crMemoryRequirements.memoryTypeBits, crCreateInfo.requiredFlags, crCreateInfo.preferredFlags);
+			allocation = AllocateDedicated(crMemoryRequirements, crCreateInfo, memoryTypeIndex, pBuffer, VK_NULL_HANDLE);
+		}
+		else
+			allocation = Allocate(crMemoryRequirements, crCreateInfo);
+
+		VkResult result = m_cpDispatch->vkBindBufferMemory(m_pDevice, pBuffer, allocation.pMemory, allocation.offset);
+		assert(result == VK_SUCCESS && "Failed to bind buffer memory.");
+		return allocation;
+	}
+
+	Allocation DeviceAllocator::AllocateImage(VkImage pImage, const AllocationCreateInfo& crCreateInfo)
+	{
+		VkMemoryDedicatedRequirements memoryDedicatedRequirements{};
+		memoryDedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+		VkMemoryRequirements2 memoryRequirements2{};
+		memoryRequirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		memoryRequirements2.pNext = &memoryDedicatedRequirements;
+
+		VkImageMemoryRequirementsInfo2 imageMemoryRequirementsInfo2{};
+		imageMemoryRequirementsInfo2.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+		imageMemoryRequirementsInfo2.image = pImage;
+		m_cpDispatch->vkGetImageMemoryRequirements2(m_pDevice, &imageMemoryRequirementsInfo2, &memoryRequirements2);
+
+		Allocation allocation;
+		const VkMemoryRequirements& crMemoryRequirements = memoryRequirements2.memoryRequirements;
+		if (crCreateInfo.dedicated || memoryDedicatedRequirements.prefersDedicatedAllocation || memoryDedicatedRequirements.requiresDedicatedAllocation)
+		{
+			uint32_t memoryTypeIndex = FindMemoryTypeIndex(m_MemoryProperties, crMemoryRequirements.memoryTypeBits, crCreateInfo.requiredFlags, crCreateInfo.preferredFlags);
+			allocation = AllocateDedicated(crMemoryRequirements, crCreateInfo, memoryTypeIndex, VK_NULL_HANDLE, pImage);
+		}
+		else
+			allocation = Allocate(crMemoryRequirements, crCreateInfo);
+
+		VkResult result = m_cpDispatch->vkBindImageMemory(m_pDevice, pImage, allocation.pMemory, allocation.offset);
+		assert(result == VK_SUCCESS && "Failed to bind image memory.");
+		return allocation;
+	}
+
+	Allocation DeviceAllocator::Allocate(const VkMemoryRequirements& crMemoryRequirements, const AllocationCreateInfo& crCreateInfo)
+	{
+		uint32_t memoryTypeIndex = FindMemoryTypeIndex(m_MemoryProperties, crMemoryRequirements.memoryTypeBits, crCreateInfo.requiredFlags, crCreateInfo.preferredFlags);
+		assert((!crCreateInfo.mapped || (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) &&
+			"Only host visible memory can be mapped.");
+
+		// Buddy ranges are aligned to their own size, so rounding up to the alignment satisfies it too.
+		VkDeviceSize allocationSize = std::bit_ceil(std::max({ crMemoryRequirements.size, crMemoryRequirements.alignment, MIN_ALLOCATION_SIZE }));
+		if (crCreateInfo.dedicated || allocationSize > m_BlockSizes[memoryTypeIndex] / 2)
+			return AllocateDedicated(crMemoryRequirements, crCreateInfo, memoryTypeIndex, VK_NULL_HANDLE, VK_NULL_HANDLE);
+
+		uint32_t order = static_cast<uint32_t>(std::countr_zero(allocationSize / MIN_ALLOCATION_SIZE));
+
+		std::lock_guard lock(m_Mutex);
+		Pool& rPool = m_Pools[memoryTypeIndex][crCreateInfo.linear ? 0 : 1];
+
+		Block* pBlock = nullptr;
+		VkDeviceSize offset = 0;
+		for (std::unique_ptr<Block>& rpBlock : rPool.blocks)
+		{
+			if (AllocateFromBlock(*rpBlock, order, offset))
+			{
+				pBlock = rpBlock.get();
+				break;
+			}
+		}
+
+		if (pBlock == nullptr)
+		{
+			pBlock = CreateBlock(memoryTypeIndex, crCreateInfo.linear);
+			bool allocated = AllocateFromBlock(*pBlock, order, offset);
+			assert(allocated && "Failed to allocate from a new block.");
+		}
+
+		pBlock->allocationCount++;
+		pBlock->usedBytes += allocationSize;
+		pBlock->requestedBytes += crMemoryRequirements.size;
+
+		Allocation allocation;
+		allocation.pMemory = pBlock->pMemory;
+		allocation.offset = offset;
+		allocation.size = crMemoryRequirements.size;
+		allocation.pMappedData = crCreateInfo.mapped ? pBlock->pMappedData + offset : nullptr;
+		allocation.memoryTypeIndex = memoryTypeIndex;
+		allocation.pBlock = pBlock;
+		allocation.order = order;
+		return allocation;
+	}
+
+	void DeviceAllocator::Free(Allocation& rAllocation)
+	{
+		if (rAllocation.pMemory == VK_NULL_HANDLE)
+			return;
+
+		std::lock_guard lock(m_Mutex);
+
+		if (rAllocation.pBlock == nullptr)
+		{
+			// Freeing memory implicitly unmaps it.
+			m_cpDispatch->vkFreeMemory(m_pDevice, rAllocation.pMemory, m_cpDispatch->cpAllocationCallbacks);
+			m_DeviceMemoryCount--;
+			m_DedicatedAllocationCount--;
+			m_DedicatedBytes -= rAllocation.size;
+			rAllocation = {};
+			return;
+		}
+
+		Block* pBlock = static_cast<Block*>(rAllocation.pBlock);
+		FreeToBlock(*pBlock, rAllocation.order, rAllocation.offset);
+		pBlock->allocationCount--;
+		pBlock->usedBytes -= MIN_ALLOCATION_SIZE << rAllocation.order;
+		pBlock->requestedBytes -= rAllocation.size;
+
+		// Keep one empty block around per pool, so an allocation that comes and goes doesn't hit the driver every time.
+		if (pBlock->allocationCount == 0)
+		{
+			Pool& rPool = m_Pools[pBlock->memoryTypeIndex][pBlock->linear ? 0 : 1];
+			bool hasOtherEmptyBlock = std::any_of(rPool.blocks.begin(), rPool.blocks.end(), [pBlock](const std::unique_ptr<Block>& crpBlock)
+			{
+				return crpBlock.get() != pBlock && crpBlock->allocationCount == 0;
+			});
+
+			if (hasOtherEmptyBlock)
+			{
+				DestroyBlock(pBlock);
+				std::erase_if(rPool.blocks, [pBlock](const std::unique_ptr<Block>& crpBlock) { return crpBlock.get() == pBlock; });
+			}
+		}
+
+		rAllocation = {};
+	}
+
+	void DeviceAllocator::FlushMapped(const Allocation& crAllocation, VkDeviceSize offset, VkDeviceSize size) const
+	{
+		if (IsCoherent(crAllocation))
+			return;
+
+		VkMappedMemoryRange mappedMemoryRange = MakeMappedMemoryRange(crAllocation, offset, size);
+		VkResult result = m_cpDispatch->vkFlushMappedMemoryRanges(m_pDevice, 1, &mappedMemoryRange);
+		assert(result == VK_SUCCESS && "Failed to flush mapped memory.");
+	}
+
+	void DeviceAllocator::InvalidateMapped(const Allocation& crAllocation, VkDeviceSize offset, VkDeviceSize size) const
+	{
+		if (IsCoherent(crAllocation))
+			return;
+
+		VkMappedMemoryRange mappedMemoryRange = MakeMappedMemoryRange(crAllocation, offset, size);
+		VkResult result = m_cpDispatch->vkInvalidateMappedMemoryRanges(m_pDevice, 1, &mappedMemoryRange);
+		assert(result == VK_SUCCESS && "Failed to invalidate mapped memory.");
+	}
+
+	bool DeviceAllocator::IsCoherent(const Allocation& crAllocation) const noexcept
+	{
+		return m_MemoryProperties.memoryTypes[crAllocation.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	}
+
+	DeviceAllocator::Statistics DeviceAllocator::GetStatistics()
+	{
+		std::lock_guard lock(m_Mutex);
+
+		Statistics statistics;
+		statistics.deviceMemoryCount = m_DeviceMemoryCount;
+		statistics.dedicatedAllocationCount = m_DedicatedAllocationCount;
+		statistics.dedicatedBytes = m_DedicatedBytes;
+
+		VkDeviceSize freeBytes = 0;
+		VkDeviceSize fragmentedFreeBytes = 0;
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			for (Pool& rPool : m_Pools[i])
+			{
+				for (std::unique_ptr<Block>& rpBlock : rPool.blocks)
+				{
+					statistics.blockCount++;
+					statistics.allocationCount += rpBlock->allocationCount;
+					statistics.blockBytes += m_BlockSizes[i];
+					statistics.usedBytes += rpBlock->requestedBytes;
+					statistics.internalFragmentationBytes += rpBlock->usedBytes - rpBlock->requestedBytes;
+
+					VkDeviceSize blockFreeBytes = m_BlockSizes[i] - rpBlock->usedBytes;
+					VkDeviceSize largestFreeRange = 0;
+					for (uint32_t order = static_cast<uint32_t>(rpBlock->freeOffsets.size()); order-- > 0;)
+					{
+						if (!rpBlock->freeOffsets[order].empty())
+						{
+							largestFreeRange = MIN_ALLOCATION_SIZE << order;
+							break;
+						}
+					}
+					freeBytes += blockFreeBytes;
+					fragmentedFreeBytes += blockFreeBytes - largestFreeRange;
+				}
+			}
+		}
+
+		if (freeBytes > 0)
+			statistics.externalFragmentation = static_cast<float>(static_cast<double>(fragmentedFreeBytes) / static_cast<double>(freeBytes));
+		return statistics;
+	}
+
+	Allocation DeviceAllocator::AllocateDedicated(const VkMemoryRequirements& crMemoryRequirements, const AllocationCreateInfo& crCreateInfo,
+		uint32_t memoryTypeIndex, VkBuffer pBuffer, VkImage pImage)
+	{
+		VkMemoryDedicatedAllocateInfo memoryDedicatedAllocateInfo{};
+		memoryDedicatedAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		memoryDedicatedAllocateInfo.buffer = pBuffer;
+		memoryDedicatedAllocateInfo.image = pImage;
+
+		VkMemoryAllocateInfo memoryAllocateInfo{};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		// Only tell the driver which resource it's for if there is one, i.e. when binding is done by this allocator.
+		if (pBuffer != VK_NULL_HANDLE || pImage != VK_NULL_HANDLE)
+			memoryAllocateInfo.pNext = &memoryDedicatedAllocateInfo;
+		memoryAllocateInfo.allocationSize = crMemoryRequirements.size;
+		memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+		Allocation allocation;
+		VkResult result = m_cpDispatch->vkAllocateMemory(m_pDevice, &memoryAllocateInfo, m_cpDispatch->cpAllocationCallbacks, &allocation.pMemory);
+		assert(result == VK_SUCCESS && "Failed to allocate dedicated device memory.");
+
+		if (crCreateInfo.mapped)
+		{
+			result = m_cpDispatch->vkMapMemory(m_pDevice, allocation.pMemory, 0, VK_WHOLE_SIZE, 0, &allocation.pMappedData);
+			assert(result == VK_SUCCESS && "Failed to map dedicated device memory.");
+		}
+
+		allocation.offset = 0;
+		allocation.size = crMemoryRequirements.size;
+		allocation.memoryTypeIndex = memoryTypeIndex;
+
+		std::lock_guard lock(m_Mutex);
+		m_DeviceMemoryCount++;
+		m_DedicatedAllocationCount++;
+		m_DedicatedBytes += crMemoryRequirements.size;
+		assert(m_DeviceMemoryCount <= m_MaxMemoryAllocationCount && "Exceeded maxMemoryAllocationCount.");
+		return allocation;
+	}
+
+	DeviceAllocator::Block* DeviceAllocator::CreateBlock(uint32_t memoryTypeIndex, bool linear)
+	{
+		std::unique_ptr<Block> pBlock = std::make_unique<Block>();
+		pBlock->memoryTypeIndex = memoryTypeIndex;
+		pBlock->linear = linear;
+
+		VkMemoryAllocateInfo memoryAllocateInfo{};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = m_BlockSizes[memoryTypeIndex];
+		memoryAllocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+		VkResult result = m_cpDispatch->vkAllocateMemory(m_pDevice, &memoryAllocateInfo, m_cpDispatch->cpAllocationCallbacks, &pBlock->pMemory);
+		assert(result == VK_SUCCESS && "Failed to allocate device memory block.");
+
+		if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			result = m_cpDispatch->vkMapMemory(m_pDevice, pBlock->pMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&pBlock->pMappedData));
+			assert(result == VK_SUCCESS && "Failed to map device memory block.");
+		}
+
+		// The whole block starts out as one free range of the highest order.
+		pBlock->freeOffsets.resize(m_MaxOrders[memoryTypeIndex] + 1);
+		pBlock->freeOffsets.back().insert(0);
+
+		m_DeviceMemoryCount++;
+		assert(m_DeviceMemoryCount <= m_MaxMemoryAllocationCount && "Exceeded maxMemoryAllocationCount.");
+
+		Pool& rPool = m_Pools[memoryTypeIndex][linear ? 0 : 1];
+		rPool.blocks.push_back(std::move(pBlock));
+		return rPool.blocks.back().get();
+	}
+
+	void DeviceAllocator::DestroyBlock(Block* pBlock)
+	{
+		m_cpDispatch->vkFreeMemory(m_pDevice, pBlock->pMemory, m_cpDispatch->cpAllocationCallbacks);
+		m_DeviceMemoryCount--;
+	}
+
+	bool DeviceAllocator::AllocateFromBlock(Block& rBlock, uint32_t order, VkDeviceSize& rOffset)
+	{
+		// Find the smallest free range that fits, then split it in halves down to the requested order.
+		uint32_t freeOrder = order;
+		while (freeOrder < rBlock.freeOffsets.size() && rBlock.freeOffsets[freeOrder].empty())
+			freeOrder++;
+		if (freeOrder >= rBlock.freeOffsets.size())
+			return false;
+
+		auto it = rBlock.freeOffsets[freeOrder].begin();
+		VkDeviceSize offset = *it;
+		rBlock.freeOffsets[freeOrder].erase(it);
+
+		while (freeOrder > order)
+		{
+			freeOrder--;
+			rBlock.freeOffsets[freeOrder].insert(offset + (MIN_ALLOCATION_SIZE << freeOrder));
+		}
+
+		rOffset = offset;
+		return true;
+	}
+
+	void DeviceAllocator::FreeToBlock(Block& rBlock, uint32_t order, VkDeviceSize offset)
+	{
+		// Merge with the buddy range for as long as it's free too.
+		while (order + 1 < rBlock.freeOffsets.size())
+		{
+			VkDeviceSize buddyOffset = offset ^ (MIN_ALLOCATION_SIZE << order);
+			auto it = rBlock.freeOffsets[order].find(buddyOffset);
+			if (it == rBlock.freeOffsets[order].end())
+				break;
+
+			rBlock.freeOffsets[order].erase(it);
+			offset = std::min(offset, buddyOffset);
+			order++;
+		}
+
+		rBlock.freeOffsets[order].insert(offset);
+	}
+
+	VkMappedMemoryRange DeviceAllocator::MakeMappedMemoryRange(const Allocation& crAllocation, VkDeviceSize offset, VkDeviceSize size) const
+	{
+		// Ranges have to be aligned to nonCoherentAtomSize. Buddy ranges are at least MIN_ALLOCATION_SIZE aligned,
+		// so widening the range to the atom size never reaches into memory that isn't mapped.
+		if (size == VK_WHOLE_SIZE)
+			size = crAllocation.size - offset;
+
+		VkDeviceSize begin = (crAllocation.offset + offset) / m_NonCoherentAtomSize * m_NonCoherentAtomSize;
+		VkDeviceSize end = AlignUp(crAllocation.offset + offset + size, m_NonCoherentAtomSize);
+
+		VkMappedMemoryRange mappedMemoryRange{};
+		mappedMemoryRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		mappedMemoryRange.memory = crAllocation.pMemory;
+		mappedMemoryRange.offset = begin;
+		// A dedicated allocation's size isn't necessarily a multiple of the atom size, but its end can always be reached with VK_WHOLE_SIZE.
+		mappedMemoryRange.size = crAllocation.pBlock == nullptr && end >= crAllocation.size ? VK_WHOLE_SIZE : end - begin;
+		return mappedMemoryRange;
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "Rendering/DeviceDispatch.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace rendering
+{
+	struct AllocationCreateInfo
+	{
+		VkMemoryPropertyFlags requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		VkMemoryPropertyFlags preferredFlags = 0;
+		// Buffers and linearly tiled images. They're kept in separate blocks from optimally tiled images,
+		// so bufferImageGranularity never has to be accounted for.
+		bool linear = true;
+		// Give the resource its own VkDeviceMemory, e.g. for big render targets. This also happens for
+		// resources bigger than half a block, or when the driver prefers it.
+		bool dedicated = false;
+		// Persistently map the memory. Requires VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT.
+		bool mapped = false;
+	};
+
+	struct Allocation
+	{
+		VkDeviceMemory pMemory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		// Only set if the allocation was created mapped.
+		void* pMappedData = nullptr;
+		uint32_t memoryTypeIndex = 0;
+	private:
+		friend class DeviceAllocator;
+		// Null for dedicated allocations.
+		void* pBlock = nullptr;
+		uint32_t order = 0;
+	};
+
+	// Sub-allocates device memory out of big per memory type blocks with a buddy allocator, so the number of
+	// VkDeviceMemory objects stays far below maxMemoryAllocationCount and most allocations never reach the driver.
+	// All functions are thread safe.
+	class DeviceAllocator
+	{
+	public:
+		struct Statistics
+		{
+			// VkDeviceMemory objects, compare against maxMemoryAllocationCount.
+			uint32_t deviceMemoryCount = 0;
+			uint32_t blockCount = 0;
+			uint32_t allocationCount = 0;
+			uint32_t dedicatedAllocationCount = 0;
+			VkDeviceSize blockBytes = 0;
+			VkDeviceSize usedBytes = 0;
+			VkDeviceSize dedicatedBytes = 0;
+			// Bytes lost to rounding allocations up to a power of two.
+			VkDeviceSize internalFragmentationBytes = 0;
+			// 1 - (largest free range / free bytes) per block, weighted by each block's free bytes.
+			// 0 means every block's free memory is one contiguous range.
+			float externalFragmentation = 0.0f;
+		};
+
+		static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+		static constexpr VkDeviceSize MIN_ALLOCATION_SIZE = 256;
+	public:
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, const VkPhysicalDeviceProperties& crPhysicalDeviceProperties,
+			const VkPhysicalDeviceMemoryProperties& crMemoryProperties, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+		void Destroy();
+
+		// Allocates memory for the resource, and binds it.
+		Allocation AllocateBuffer(VkBuffer pBuffer, const AllocationCreateInfo& crCreateInfo);
+		Allocation AllocateImage(VkImage pImage, const AllocationCreateInfo& crCreateInfo);
+		Allocation Allocate(const VkMemoryRequirements& crMemoryRequirements, const AllocationCreateInfo& crCreateInfo);
+		void Free(Allocation& rAllocation);
+
+		// Only needed for mapped allocations in memory without VK_MEMORY_PROPERTY_HOST_COHERENT_BIT.
+		// Both are no-ops for coherent memory.
+		void FlushMapped(const Allocation& crAllocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+		void InvalidateMapped(const Allocation& crAllocation, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE) const;
+		bool IsCoherent(const Allocation& crAllocation) const noexcept;
+
+		Statistics GetStatistics();
+		inline const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const noexcept { return m_MemoryProperties; }
+	private:
+		struct Block
+		{
+			VkDeviceMemory pMemory = VK_NULL_HANDLE;
+			// Every block of a host visible memory type is mapped for its whole lifetime.
+			uint8_t* pMappedData = nullptr;
+			uint32_t memoryTypeIndex = 0;
+			bool linear = true;
+			// freeOffsets[order] holds the offsets of every free range of size MIN_ALLOCATION_SIZE << order.
+			std::vector<std::unordered_set<VkDeviceSize>> freeOffsets;
+			uint32_t allocationCount = 0;
+			VkDeviceSize usedBytes = 0;
+			VkDeviceSize requestedBytes = 0;
+		};
+
+		struct Pool
+		{
+			std::vector<std::unique_ptr<Block>> blocks;
+		};
+	private:
+		Allocation AllocateDedicated(const VkMemoryRequirements& crMemoryRequirements, const AllocationCreateInfo& crCreateInfo,
+			uint32_t memoryTypeIndex, VkBuffer pBuffer, VkImage pImage);
+		Block* CreateBlock(uint32_t memoryTypeIndex, bool linear);
+		void DestroyBlock(Block* pBlock);
+		static bool AllocateFromBlock(Block& rBlock, uint32_t order, VkDeviceSize& rOffset);
+		static void FreeToBlock(Block& rBlock, uint32_t order, VkDeviceSize offset);
+		VkMappedMemoryRange MakeMappedMemoryRange(const Allocation& crAllocation, VkDeviceSize offset, VkDeviceSize size) const;
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+		VkDeviceSize m_NonCoherentAtomSize = 1;
+		uint32_t m_MaxMemoryAllocationCount = 0;
+
+		// Per memory type block sizes, smaller for small heaps.
+		std::array<VkDeviceSize, VK_MAX_MEMORY_TYPES> m_BlockSizes{};
+		std::array<uint32_t, VK_MAX_MEMORY_TYPES> m_MaxOrders{};
+		// Indexed by memory type, then 0 for linear and 1 for non-linear resources.
+		std::array<std::array<Pool, 2>, VK_MAX_MEMORY_TYPES> m_Pools;
+
+		uint32_t m_DeviceMemoryCount = 0;
+		uint32_t m_DedicatedAllocationCount = 0;
+		VkDeviceSize m_DedicatedBytes = 0;
+
+		std::mutex m_Mutex;
+	};
+}
@@ -0,0 +1,12 @@
+#include "Rendering/DeviceDispatch.h"
+
+namespace rendering
+{
+	void DeviceDispatch::Load(VkDevice pDevice, const VkAllocationCallbacks* cpAllocationCallbacks)
+	{
+		this->cpAllocationCallbacks = cpAllocationCallbacks;
+#define DEVICE_DISPATCH_LOAD(name) name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(pDevice, #name));
+		DEVICE_DISPATCH_FUNCTIONS(DEVICE_DISPATCH_LOAD)
+#undef DEVICE_DISPATCH_LOAD
+	}
+}
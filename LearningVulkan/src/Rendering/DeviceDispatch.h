@@ -0,0 +1,89 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+
+// Every device level function the engine calls, i.e. every function whose first parameter is a VkDevice, VkQueue or
+// VkCommandBuffer. Add a line here to get a typed member with the same name in DeviceDispatch.
+#define DEVICE_DISPATCH_FUNCTIONS(X) \
+	/* Device */ \
+	X(vkDestroyDevice) \
+	X(vkDeviceWaitIdle) \
+	X(vkGetDeviceQueue) \
+	/* Queue */ \
+	X(vkQueueSubmit2) \
+	/* Memory */ \
+	X(vkAllocateMemory) \
+	X(vkFreeMemory) \
+	X(vkMapMemory) \
+	X(vkFlushMappedMemoryRanges) \
+	X(vkInvalidateMappedMemoryRanges) \
+	X(vkBindBufferMemory) \
+	X(vkBindImageMemory) \
+	X(vkGetBufferMemoryRequirements2) \
+	X(vkGetImageMemoryRequirements2) \
+	/* Resources */ \
+	X(vkCreateBuffer) \
+	X(vkDestroyBuffer) \
+	X(vkCreateImage) \
+	X(vkDestroyImage) \
+	X(vkCreateImageView) \
+	X(vkDestroyImageView) \
+	/* Pipeline cache */ \
+	X(vkCreatePipelineCache) \
+	X(vkDestroyPipelineCache) \
+	X(vkGetPipelineCacheData) \
+	X(vkMergePipelineCaches) \
+	/* Queries */ \
+	X(vkCreateQueryPool) \
+	X(vkDestroyQueryPool) \
+	X(vkGetQueryPoolResults) \
+	/* Synchronization */ \
+	X(vkCreateSemaphore) \
+	X(vkDestroySemaphore) \
+	X(vkWaitSemaphores) \
+	X(vkGetSemaphoreCounterValue) \
+	/* Command buffers */ \
+	X(vkCreateCommandPool) \
+	X(vkDestroyCommandPool) \
+	X(vkResetCommandPool) \
+	X(vkAllocateCommandBuffers) \
+	X(vkBeginCommandBuffer) \
+	X(vkEndCommandBuffer) \
+	/* Commands */ \
+	X(vkCmdPipelineBarrier2) \
+	X(vkCmdBeginRendering) \
+	X(vkCmdEndRendering) \
+	X(vkCmdExecuteCommands) \
+	X(vkCmdCopyBuffer) \
+	X(vkCmdCopyBufferToImage) \
+	X(vkCmdCopyImageToBuffer) \
+	X(vkCmdBlitImage) \
+	X(vkCmdFillBuffer) \
+	X(vkCmdSetViewport) \
+	X(vkCmdSetScissor) \
+	X(vkCmdResetQueryPool) \
+	X(vkCmdWriteTimestamp2) \
+	/* VK_KHR_swapchain */ \
+	X(vkCreateSwapchainKHR) \
+	X(vkDestroySwapchainKHR) \
+	X(vkGetSwapchainImagesKHR) \
+	X(vkAcquireNextImageKHR) \
+	X(vkQueuePresentKHR)
+
+namespace rendering
+{
+	// Typed function pointers loaded straight from the driver with vkGetDeviceProcAddr, so device and command buffer
+	// calls skip the loader's trampoline. Only valid for the device they were loaded for.
+	// Functions from extensions that weren't enabled (e.g. swap chain functions in headless mode) are left null.
+	struct DeviceDispatch
+	{
+#define DEVICE_DISPATCH_MEMBER(name) PFN_##name name = nullptr;
+		DEVICE_DISPATCH_FUNCTIONS(DEVICE_DISPATCH_MEMBER)
+#undef DEVICE_DISPATCH_MEMBER
+		// Host allocation callbacks for every object created through this dispatch. Null for the driver's own allocator.
+		const VkAllocationCallbacks* cpAllocationCallbacks = nullptr;
+
+		void Load(VkDevice pDevice, const VkAllocationCallbacks* cpAllocationCallbacks = nullptr);
+	};
+}
@@ -0,0 +1,141 @@
+#include "Rendering/GpuProfiler.h"
+#include <assert.h>
+#include <algorithm>
+
+namespace rendering
+{
+	void GpuProfiler::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, float timestampPeriod, uint32_t timestampValidBits, uint32_t frameCount)
+	{
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_TimestampPeriod = timestampPeriod;
+		m_TimestampMask = timestampValidBits >= 64 ? UINT64_MAX : (1ull << timestampValidBits) - 1;
+		m_FrameCount = frameCount;
+		m_pFrames = std::make_unique<FrameQueries[]>(frameCount);
+
+		if (!IsSupported())
+			return;
+
+		// Two queries per scope, one for its start and one for its end.
+		VkQueryPoolCreateInfo queryPoolCreateInfo{};
+		queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryPoolCreateInfo.queryCount = MAX_SCOPES_PER_FRAME * 2;
+
+		for (uint32_t i = 0; i < frameCount; i++)
+		{
+			VkResult result = m_cpDispatch->vkCreateQueryPool(m_pDevice, &queryPoolCreateInfo, m_cpDispatch->cpAllocationCallbacks, &m_pFrames[i].pQueryPool);
+			assert(result == VK_SUCCESS && "Failed to create timestamp query pool.");
+		}
+
+		m_Timestamps.resize(MAX_SCOPES_PER_FRAME * 2);
+		m_Results.reserve(MAX_SCOPES_PER_FRAME);
+
+#if CONFIG_PROFILE
+		m_pTrack = &core::Profiler::CreateTrack("GPU Graphics Queue");
+#endif
+	}
+
+	void GpuProfiler::Destroy()
+	{
+		for (uint32_t i = 0; i < m_FrameCount; i++)
+			if (m_pFrames[i].pQueryPool != VK_NULL_HANDLE)
+				m_cpDispatch->vkDestroyQueryPool(m_pDevice, m_pFrames[i].pQueryPool, m_cpDispatch->cpAllocationCallbacks);
+		m_pFrames.reset();
+		m_FrameCount = 0;
+		m_pCurrentFrame = nullptr;
+	}
+
+	void GpuProfiler::BeginFrame(uint32_t frameIndex, VkCommandBuffer pCommandBuffer)
+	{
+		if (!IsSupported())
+			return;
+
+		// Both stay empty if nothing could be read back, so they always describe the same frame.
+		FrameQueries& rFrame = m_pFrames[frameIndex];
+		m_Results.clear();
+		m_FrameNanoseconds = 0;
+		ReadResults(rFrame);
+
+		m_cpDispatch->vkCmdResetQueryPool(pCommandBuffer, rFrame.pQueryPool, 0, MAX_SCOPES_PER_FRAME * 2);
+		rFrame.scopeCount.store(0, std::memory_order_relaxed);
+		m_pCurrentFrame = &rFrame;
+	}
+
+	void GpuProfiler::EndFrame()
+	{
+#if CONFIG_PROFILE
+		if (m_pCurrentFrame)
+			m_pCurrentFrame->submitNanoseconds = core::Profiler::Now();
+#endif
+	}
+
+	uint32_t GpuProfiler::BeginScope(VkCommandBuffer pCommandBuffer, const char* cpName, VkPipelineStageFlags2 stage)
+	{
+		if (!m_pCurrentFrame)
+			return INVALID_SCOPE;
+
+		uint32_t scope = m_pCurrentFrame->scopeCount.fetch_add(1, std::memory_order_relaxed);
+		if (scope >= MAX_SCOPES_PER_FRAME)
+			return INVALID_SCOPE;
+
+		m_pCurrentFrame->names[scope] = cpName;
+		m_cpDispatch->vkCmdWriteTimestamp2(pCommandBuffer, stage, m_pCurrentFrame->pQueryPool, scope * 2);
+		return scope;
+	}
+
+	void GpuProfiler::EndScope(VkCommandBuffer pCommandBuffer, uint32_t scope, VkPipelineStageFlags2 stage)
+	{
+		if (scope == INVALID_SCOPE)
+			return;
+
+		m_cpDispatch->vkCmdWriteTimestamp2(pCommandBuffer, stage, m_pCurrentFrame->pQueryPool, scope * 2 + 1);
+	}
+
+	void GpuProfiler::ReadResults(FrameQueries& rFrame)
+	{
+		uint32_t scopeCount = std::min(rFrame.scopeCount.load(std::memory_order_relaxed), MAX_SCOPES_PER_FRAME);
+		if (scopeCount == 0)
+			return;
+
+		// The frame's submission has been waited on, so every query is available and this doesn't block. A scope that was
+		// begun but never ended leaves its end query unavailable, in which case the frame's results are skipped.
+		VkResult result = m_cpDispatch->vkGetQueryPoolResults(m_pDevice, rFrame.pQueryPool, 0, scopeCount * 2,
+			scopeCount * 2 * sizeof(uint64_t), m_Timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+		if (result == VK_NOT_READY)
+			return;
+		assert(result == VK_SUCCESS && "Failed to get timestamp query results.");
+
+		uint64_t firstTimestamp = UINT64_MAX;
+		for (uint32_t i = 0; i < scopeCount; i++)
+			firstTimestamp = std::min(firstTimestamp, m_Timestamps[i * 2] & m_TimestampMask);
+
+		for (uint32_t i = 0; i < scopeCount; i++)
+		{
+			// Masking handles counters narrower than 64 bits wrapping around within the frame.
+			uint64_t start = ((m_Timestamps[i * 2] & m_TimestampMask) - firstTimestamp) & m_TimestampMask;
+			uint64_t duration = ((m_Timestamps[i * 2 + 1] & m_TimestampMask) - (m_Timestamps[i * 2] & m_TimestampMask)) & m_TimestampMask;
+
+			ScopeResult& rResult = m_Results.emplace_back();
+			rResult.cpName = rFrame.names[i];
+			rResult.startNanoseconds = static_cast<uint64_t>(start * m_TimestampPeriod);
+			rResult.durationNanoseconds = static_cast<uint64_t>(duration * m_TimestampPeriod);
+			m_FrameNanoseconds = std::max(m_FrameNanoseconds, rResult.startNanoseconds + rResult.durationNanoseconds);
+		}
+
+#if CONFIG_PROFILE
+		// Without VK_EXT_calibrated_timestamps there's no shared clock, but GPU work never starts before it was
+		// submitted. So the largest offset that puts a frame's first timestamp at its submit time is the tightest
+		// estimate, and it only gets better the more frames there have been.
+		int64_t gpuFrameNanoseconds = static_cast<int64_t>(firstTimestamp * m_TimestampPeriod);
+		m_CpuOffsetNanoseconds = std::max(m_CpuOffsetNanoseconds, static_cast<int64_t>(rFrame.submitNanoseconds) - gpuFrameNanoseconds);
+
+		uint64_t frameStartNanoseconds = static_cast<uint64_t>(gpuFrameNanoseconds + m_CpuOffsetNanoseconds);
+		for (const ScopeResult& crResult : m_Results)
+		{
+			uint64_t startNanoseconds = frameStartNanoseconds + crResult.startNanoseconds;
+			core::Profiler::Record(*m_pTrack, crResult.cpName, startNanoseconds, startNanoseconds + crResult.durationNanoseconds);
+		}
+#endif
+	}
+}
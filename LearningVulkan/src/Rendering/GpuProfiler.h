@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Core/Profiler.h"
+#include "Rendering/DeviceDispatch.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace rendering
+{
+	// Times named scopes of a queue's command buffers with timestamp queries. Every frame in flight has its own query
+	// pool, which is only read back once that frame's submission has been waited on, so reading results never stalls.
+	// Results lag MAX_FRAMES_IN_FLIGHT frames behind. Scopes nest by time, and can also be written from secondary
+	// command buffers recorded on other threads.
+	// In the Profile configuration, results are also recorded into the CPU profiler's trace on their own track.
+	class GpuProfiler
+	{
+	public:
+		static constexpr uint32_t MAX_SCOPES_PER_FRAME = 256;
+		static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+
+		struct ScopeResult
+		{
+			const char* cpName = nullptr;
+			// Relative to the frame's earliest timestamp.
+			uint64_t startNanoseconds = 0;
+			uint64_t durationNanoseconds = 0;
+		};
+	public:
+		// A timestampValidBits of 0 means the queue doesn't support timestamps, in which case every call is a no-op.
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, float timestampPeriod, uint32_t timestampValidBits, uint32_t frameCount);
+		void Destroy();
+
+		// Call once the frame's previous submission has finished, before any scope of the frame is recorded.
+		// Reads back that submission's results, and resets the frame's queries at the start of pCommandBuffer.
+		void BeginFrame(uint32_t frameIndex, VkCommandBuffer pCommandBuffer);
+		// Call right before the frame is submitted, to line up its timestamps with the CPU trace.
+		void EndFrame();
+
+		// cpName must be a string literal. Thread safe, as long as each command buffer is only recorded by one thread.
+		// stage must be a single stage. By default the begin timestamp doesn't wait for anything, and the end one
+		// waits for every earlier command.
+		uint32_t BeginScope(VkCommandBuffer pCommandBuffer, const char* cpName, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE);
+		void EndScope(VkCommandBuffer pCommandBuffer, uint32_t scope, VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+		// Read back by the last BeginFrame(), in the order the frame's scopes were begun. Empty if it read none.
+		// Valid until the next BeginFrame().
+		inline std::span<const ScopeResult> GetResults() const noexcept { return m_Results; }
+		// From the frame's first timestamp to its last, of the results read back by the last BeginFrame(). 0 if it read none.
+		inline uint64_t GetFrameNanoseconds() const noexcept { return m_FrameNanoseconds; }
+		inline bool IsSupported() const noexcept { return m_TimestampMask != 0; }
+	private:
+		struct FrameQueries
+		{
+			VkQueryPool pQueryPool = VK_NULL_HANDLE;
+			std::array<const char*, MAX_SCOPES_PER_FRAME> names{};
+			std::atomic<uint32_t> scopeCount = 0;
+#if CONFIG_PROFILE
+			uint64_t submitNanoseconds = 0;
+#endif
+		};
+	private:
+		void ReadResults(FrameQueries& rFrame);
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		double m_TimestampPeriod = 1.0;
+		uint64_t m_TimestampMask = 0;
+
+		std::unique_ptr<FrameQueries[]> m_pFrames;
+		uint32_t m_FrameCount = 0;
+		FrameQueries* m_pCurrentFrame = nullptr;
+
+		std::vector<uint64_t> m_Timestamps;
+		std::vector<ScopeResult> m_Results;
+		uint64_t m_FrameNanoseconds = 0;
+
+#if CONFIG_PROFILE
+		core::Profiler::Track* m_pTrack = nullptr;
+		// Added to GPU nanoseconds to get CPU profiler nanoseconds.
+		int64_t m_CpuOffsetNanoseconds = INT64_MIN;
+#endif
+	};
+
+	class GpuProfileScope
+	{
+	public:
+		inline GpuProfileScope(GpuProfiler& rProfiler, VkCommandBuffer pCommandBuffer, const char* cpName)
+			: m_rProfiler(rProfiler), m_pCommandBuffer(pCommandBuffer), m_Scope(rProfiler.BeginScope(pCommandBuffer, cpName)) {}
+		inline ~GpuProfileScope() { m_rProfiler.EndScope(m_pCommandBuffer, m_Scope); }
+
+		GpuProfileScope(const GpuProfileScope&) = delete;
+		GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+	private:
+		GpuProfiler& m_rProfiler;
+		VkCommandBuffer m_pCommandBuffer;
+		uint32_t m_Scope;
+	};
+}
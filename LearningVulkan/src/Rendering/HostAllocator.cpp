@@ -0,0 +1,226 @@
+#include "Rendering/HostAllocator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace rendering
+{
+	// Only the owning thread bumps the offset. Frees can come from any thread, so the live count is atomic.
+	// Command scope allocations never outlive the call that made them, so nothing is live once the thread exits.
+	struct HostAllocator::Arena
+	{
+		std::unique_ptr<std::byte[]> pMemory{ new std::byte[ARENA_SIZE] };
+		size_t offset = 0;
+		std::atomic<uint32_t> liveCount = 0;
+	};
+
+	void HostAllocator::Create()
+	{
+		for (AtomicScopeStatistics& rScope : m_Scopes)
+		{
+			rScope.allocationCount = 0;
+			rScope.liveAllocationCount = 0;
+			rScope.liveBytes = 0;
+			rScope.peakBytes = 0;
+			rScope.internalBytes = 0;
+		}
+		m_ArenaAllocationCount = 0;
+		m_ArenaFallbackCount = 0;
+
+		m_Callbacks.pUserData = this;
+		m_Callbacks.pfnAllocation = Allocate;
+		m_Callbacks.pfnReallocation = Reallocate;
+		m_Callbacks.pfnFree = Free;
+		m_Callbacks.pfnInternalAllocation = NotifyInternalAllocation;
+		m_Callbacks.pfnInternalFree = NotifyInternalFree;
+	}
+
+	void HostAllocator::Destroy()
+	{
+#if !CONFIG_DIST // ENABLE_LOGGING
+		// Everything created with the callbacks should be destroyed by now.
+		for (size_t i = 0; i < SCOPE_COUNT; i++)
+		{
+			uint64_t liveAllocationCount = m_Scopes[i].liveAllocationCount.load(std::memory_order_relaxed);
+			if (liveAllocationCount != 0)
+				std::cerr << "Host allocator: " << liveAllocationCount << " " << GetScopeName(static_cast<VkSystemAllocationScope>(i)) <<
+					" scope allocations (" << m_Scopes[i].liveBytes.load(std::memory_order_relaxed) << " bytes) were never freed.\n";
+		}
+#endif
+	}
+
+	HostAllocator::Statistics HostAllocator::GetStatistics() const
+	{
+		Statistics statistics;
+		for (size_t i = 0; i < SCOPE_COUNT; i++)
+		{
+			const AtomicScopeStatistics& crScope = m_Scopes[i];
+			ScopeStatistics& rScope = statistics.scopes[i];
+			rScope.allocationCount = crScope.allocationCount.load(std::memory_order_relaxed);
+			rScope.liveAllocationCount = crScope.liveAllocationCount.load(std::memory_order_relaxed);
+			rScope.liveBytes = crScope.liveBytes.load(std::memory_order_relaxed);
+			rScope.peakBytes = crScope.peakBytes.load(std::memory_order_relaxed);
+			rScope.internalBytes = crScope.internalBytes.load(std::memory_order_relaxed);
+		}
+		statistics.arenaAllocationCount = m_ArenaAllocationCount.load(std::memory_order_relaxed);
+		statistics.arenaFallbackCount = m_ArenaFallbackCount.load(std::memory_order_relaxed);
+		return statistics;
+	}
+
+	void HostAllocator::PrintStatistics(std::ostream& rStream, const Statistics& crStatistics)
+	{
+		char line[128];
+		std::snprintf(line, sizeof(line), "%-16s %12s %10s %12s %12s %12s\n", "host scope", "allocations", "live", "live KiB", "peak KiB", "internal KiB");
+		rStream << line;
+		for (size_t i = 0; i < SCOPE_COUNT; i++)
+		{
+			const ScopeStatistics& crScope = crStatistics.scopes[i];
+			std::snprintf(line, sizeof(line), "%-16s %12llu %10llu %12.1f %12.1f %12.1f\n", GetScopeName(static_cast<VkSystemAllocationScope>(i)),
+				static_cast<unsigned long long>(crScope.allocationCount), static_cast<unsigned long long>(crScope.liveAllocationCount),
+				crScope.liveBytes / 1024.0, crScope.peakBytes / 1024.0, crScope.internalBytes / 1024.0);
+			rStream << line;
+		}
+		std::snprintf(line, sizeof(line), "command arena: %llu allocations, %llu fell back to the heap\n",
+			static_cast<unsigned long long>(crStatistics.arenaAllocationCount), static_cast<unsigned long long>(crStatistics.arenaFallbackCount));
+		rStream << line;
+	}
+
+	const char* HostAllocator::GetScopeName(VkSystemAllocationScope scope)
+	{
+		switch (scope)
+		{
+			case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+			case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+			case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+			case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+			case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+			default: return "unknown";
+		}
+	}
+
+	void* HostAllocator::Allocate(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		return static_cast<HostAllocator*>(pUserData)->AllocateTracked(size, alignment, scope);
+	}
+
+	void* HostAllocator::Reallocate(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		HostAllocator* pAllocator = static_cast<HostAllocator*>(pUserData);
+		if (!pOriginal)
+			return pAllocator->AllocateTracked(size, alignment, scope);
+		if (size == 0)
+		{
+			pAllocator->FreeTracked(pOriginal);
+			return nullptr;
+		}
+
+		// On failure the original must be left untouched.
+		void* pMemory = pAllocator->AllocateTracked(size, alignment, scope);
+		if (!pMemory)
+			return nullptr;
+
+		const AllocationHeader* cpOriginalHeader = reinterpret_cast<const AllocationHeader*>(static_cast<std::byte*>(pOriginal) - sizeof(AllocationHeader));
+		memcpy(pMemory, pOriginal, std::min<size_t>(size, cpOriginalHeader->size));
+		pAllocator->FreeTracked(pOriginal);
+		return pMemory;
+	}
+
+	void HostAllocator::Free(void* pUserData, void* pMemory)
+	{
+		static_cast<HostAllocator*>(pUserData)->FreeTracked(pMemory);
+	}
+
+	void HostAllocator::NotifyInternalAllocation(void* pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+	{
+		static_cast<HostAllocator*>(pUserData)->m_Scopes[scope].internalBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void HostAllocator::NotifyInternalFree(void* pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+	{
+		static_cast<HostAllocator*>(pUserData)->m_Scopes[scope].internalBytes.fetch_sub(size, std::memory_order_relaxed);
+	}
+
+	void* HostAllocator::AllocateTracked(size_t size, size_t alignment, VkSystemAllocationScope scope)
+	{
+		if (size == 0)
+			return nullptr;
+
+		// Room for the header and for aligning the allocation after it.
+		alignment = std::max(alignment, alignof(AllocationHeader));
+		size_t blockSize = sizeof(AllocationHeader) + alignment - 1 + size;
+
+		std::byte* pBlock = nullptr;
+		Arena* pArena = nullptr;
+		if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && blockSize <= MAX_ARENA_ALLOCATION_SIZE)
+		{
+			Arena& rArena = GetThreadArena();
+			// Nothing in the arena is live anymore, so it can start over.
+			if (rArena.liveCount.load(std::memory_order_acquire) == 0)
+				rArena.offset = 0;
+
+			if (rArena.offset + blockSize <= ARENA_SIZE)
+			{
+				pBlock = rArena.pMemory.get() + rArena.offset;
+				rArena.offset += blockSize;
+				rArena.liveCount.fetch_add(1, std::memory_order_relaxed);
+				pArena = &rArena;
+				m_ArenaAllocationCount.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+				m_ArenaFallbackCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		if (!pBlock)
+		{
+			pBlock = static_cast<std::byte*>(std::malloc(blockSize));
+			if (!pBlock)
+				return nullptr;
+		}
+
+		uintptr_t address = reinterpret_cast<uintptr_t>(pBlock) + sizeof(AllocationHeader);
+		address = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+
+		AllocationHeader* pHeader = reinterpret_cast<AllocationHeader*>(address - sizeof(AllocationHeader));
+		pHeader->size = size;
+		pHeader->pArena = pArena;
+		pHeader->offset = static_cast<uint32_t>(address - reinterpret_cast<uintptr_t>(pBlock));
+		pHeader->scope = static_cast<uint32_t>(scope);
+
+		AtomicScopeStatistics& rScope = m_Scopes[scope];
+		rScope.allocationCount.fetch_add(1, std::memory_order_relaxed);
+		rScope.liveAllocationCount.fetch_add(1, std::memory_order_relaxed);
+		uint64_t liveBytes = rScope.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		uint64_t peakBytes = rScope.peakBytes.load(std::memory_order_relaxed);
+		while (liveBytes > peakBytes && !rScope.peakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed));
+
+		return reinterpret_cast<void*>(address);
+	}
+
+	void HostAllocator::FreeTracked(void* pMemory)
+	{
+		if (!pMemory)
+			return;
+
+		std::byte* pBytes = static_cast<std::byte*>(pMemory);
+		const AllocationHeader* cpHeader = reinterpret_cast<const AllocationHeader*>(pBytes - sizeof(AllocationHeader));
+
+		AtomicScopeStatistics& rScope = m_Scopes[cpHeader->scope];
+		rScope.liveAllocationCount.fetch_sub(1, std::memory_order_relaxed);
+		rScope.liveBytes.fetch_sub(cpHeader->size, std::memory_order_relaxed);
+
+		// Released, so the arena's owner sees every use of the allocation as done once it sees the count reach zero.
+		if (cpHeader->pArena)
+			cpHeader->pArena->liveCount.fetch_sub(1, std::memory_order_release);
+		else
+			std::free(pBytes - cpHeader->offset);
+	}
+
+	HostAllocator::Arena& HostAllocator::GetThreadArena()
+	{
+		thread_local Arena arena;
+		return arena;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace rendering
+{
+	// VkAllocationCallbacks that count every host allocation the driver makes, per allocation scope.
+	// Command scope allocations only live for the duration of one Vulkan call, so they come from a per thread linear
+	// arena that rewinds whenever everything in it has been freed, instead of the heap. Everything else goes to the heap.
+	// The callbacks are thread safe, as Vulkan requires.
+	class HostAllocator
+	{
+	public:
+		static constexpr size_t SCOPE_COUNT = 5; // VK_SYSTEM_ALLOCATION_SCOPE_COMMAND through _INSTANCE.
+		static constexpr size_t ARENA_SIZE = 256 << 10;
+		// Bigger command scope allocations go to the heap, so one can't use up a whole arena.
+		static constexpr size_t MAX_ARENA_ALLOCATION_SIZE = ARENA_SIZE / 4;
+
+		struct ScopeStatistics
+		{
+			// Every allocation and reallocation so far.
+			uint64_t allocationCount = 0;
+			uint64_t liveAllocationCount = 0;
+			uint64_t liveBytes = 0;
+			uint64_t peakBytes = 0;
+			// Memory the driver allocated itself and only told us about, e.g. for executable code.
+			uint64_t internalBytes = 0;
+		};
+
+		struct Statistics
+		{
+			std::array<ScopeStatistics, SCOPE_COUNT> scopes;
+			uint64_t arenaAllocationCount = 0;
+			// Command scope allocations that didn't fit in their thread's arena.
+			uint64_t arenaFallbackCount = 0;
+		};
+	public:
+		void Create();
+		void Destroy();
+
+		// Pass to every vkCreate*, vkAllocate*, vkDestroy* and vkFree* call. Objects must be destroyed with the same
+		// callbacks they were created with.
+		inline const VkAllocationCallbacks* GetCallbacks() const noexcept { return &m_Callbacks; }
+
+		Statistics GetStatistics() const;
+		static void PrintStatistics(std::ostream& rStream, const Statistics& crStatistics);
+		static const char* GetScopeName(VkSystemAllocationScope scope);
+	private:
+		struct Arena;
+
+		// Sits right before every allocation, so frees know where it came from.
+		struct alignas(16) AllocationHeader
+		{
+			uint64_t size = 0;
+			Arena* pArena = nullptr; // Null for heap allocations.
+			uint32_t offset = 0; // From the start of the underlying block to the allocation.
+			uint32_t scope = 0;
+		};
+
+		struct AtomicScopeStatistics
+		{
+			std::atomic<uint64_t> allocationCount = 0;
+			std::atomic<uint64_t> liveAllocationCount = 0;
+			std::atomic<uint64_t> liveBytes = 0;
+			std::atomic<uint64_t> peakBytes = 0;
+			std::atomic<uint64_t> internalBytes = 0;
+		};
+	private:
+		static VKAPI_ATTR void* VKAPI_CALL Allocate(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void* VKAPI_CALL Reallocate(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL Free(void* pUserData, void* pMemory);
+		static VKAPI_ATTR void VKAPI_CALL NotifyInternalAllocation(void* pUserData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+		static VKAPI_ATTR void VKAPI_CALL NotifyInternalFree(void* pUserData, size_t size, VkInternalAllocationType type, VkSystemAllocationScope scope);
+
+		void* AllocateTracked(size_t size, size_t alignment, VkSystemAllocationScope scope);
+		void FreeTracked(void* pMemory);
+		static Arena& GetThreadArena();
+	private:
+		VkAllocationCallbacks m_Callbacks{};
+		std::array<AtomicScopeStatistics, SCOPE_COUNT> m_Scopes;
+		std::atomic<uint64_t> m_ArenaAllocationCount = 0;
+		std::atomic<uint64_t> m_ArenaFallbackCount = 0;
+	};
+}
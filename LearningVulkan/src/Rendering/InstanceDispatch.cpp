@@ -0,0 +1,11 @@
+#include "Rendering/InstanceDispatch.h"
+
+namespace rendering
+{
+	void InstanceDispatch::Load(VkInstance pInstance)
+	{
+#define INSTANCE_DISPATCH_LOAD(name) name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(pInstance, #name));
+		INSTANCE_DISPATCH_FUNCTIONS(INSTANCE_DISPATCH_LOAD)
+#undef INSTANCE_DISPATCH_LOAD
+	}
+}
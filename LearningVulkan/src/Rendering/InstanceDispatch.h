@@ -0,0 +1,29 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+
+// Every instance level function that isn't exported by the loader, i.e. anything from an extension.
+// Add a line here to get a typed member with the same name in InstanceDispatch.
+#define INSTANCE_DISPATCH_FUNCTIONS(X) \
+	/* VK_EXT_debug_utils */ \
+	X(vkCreateDebugUtilsMessengerEXT) \
+	X(vkDestroyDebugUtilsMessengerEXT) \
+	X(vkSetDebugUtilsObjectNameEXT) \
+	X(vkCmdBeginDebugUtilsLabelEXT) \
+	X(vkCmdEndDebugUtilsLabelEXT) \
+	X(vkCmdInsertDebugUtilsLabelEXT)
+
+namespace rendering
+{
+	// Typed function pointers, loaded once after the instance is created, so calling one is a plain indirect call.
+	// Functions from extensions that weren't enabled are left null.
+	struct InstanceDispatch
+	{
+#define INSTANCE_DISPATCH_MEMBER(name) PFN_##name name = nullptr;
+		INSTANCE_DISPATCH_FUNCTIONS(INSTANCE_DISPATCH_MEMBER)
+#undef INSTANCE_DISPATCH_MEMBER
+
+		void Load(VkInstance pInstance);
+	};
+}
@@ -0,0 +1,18 @@
+#include "Rendering/Memory.h"
+#include <assert.h>
+#include <initializer_list>
+
+namespace rendering
+{
+	uint32_t FindMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties& crMemoryProperties, uint32_t memoryTypeBits,
+		VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags)
+	{
+		for (VkMemoryPropertyFlags flags : { requiredFlags | preferredFlags, requiredFlags })
+			for (uint32_t i = 0; i < crMemoryProperties.memoryTypeCount; i++)
+				if ((memoryTypeBits & (1 << i)) && (crMemoryProperties.memoryTypes[i].propertyFlags & flags) == flags)
+					return i;
+
+		assert(false && "Failed to find suitable memory type.");
+		return UINT32_MAX;
+	}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+
+namespace rendering
+{
+	// Prefers a memory type with every preferred flag, but settles for just the required ones.
+	uint32_t FindMemoryTypeIndex(const VkPhysicalDeviceMemoryProperties& crMemoryProperties, uint32_t memoryTypeBits,
+		VkMemoryPropertyFlags requiredFlags, VkMemoryPropertyFlags preferredFlags);
+
+	constexpr VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment) noexcept
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+}
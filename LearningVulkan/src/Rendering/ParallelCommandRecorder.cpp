@@ -0,0 +1,122 @@
+#include "Rendering/ParallelCommandRecorder.h"
+#include "Core/Profiler.h"
+#include <assert.h>
+
+namespace rendering
+{
+	void ParallelCommandRecorder::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, uint32_t queueFamilyIndex, uint32_t frameCount, core::JobSystem& rJobSystem)
+	{
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_pJobSystem = &rJobSystem;
+
+		VkCommandPoolCreateInfo commandPoolCreateInfo{};
+		commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+		m_CommandPools.resize(frameCount);
+		for (std::vector<ThreadCommandPool>& rFramePools : m_CommandPools)
+		{
+			rFramePools.resize(m_pJobSystem->GetThreadCount() + 1);
+			for (ThreadCommandPool& rPool : rFramePools)
+			{
+				VkResult result = m_cpDispatch->vkCreateCommandPool(m_pDevice, &commandPoolCreateInfo, m_cpDispatch->cpAllocationCallbacks, &rPool.pCommandPool);
+				assert(result == VK_SUCCESS && "Failed to create secondary command pool.");
+			}
+		}
+	}
+
+	void ParallelCommandRecorder::Destroy()
+	{
+		// Destroying a pool frees its command buffers.
+		for (std::vector<ThreadCommandPool>& rFramePools : m_CommandPools)
+			for (ThreadCommandPool& rPool : rFramePools)
+				m_cpDispatch->vkDestroyCommandPool(m_pDevice, rPool.pCommandPool, m_cpDispatch->cpAllocationCallbacks);
+		m_CommandPools.clear();
+	}
+
+	void ParallelCommandRecorder::BeginFrame(uint32_t frameIndex)
+	{
+		m_FrameIndex = frameIndex;
+		for (ThreadCommandPool& rPool : m_CommandPools[m_FrameIndex])
+		{
+			if (rPool.usedCount == 0)
+				continue;
+
+			VkResult result = m_cpDispatch->vkResetCommandPool(m_pDevice, rPool.pCommandPool, 0);
+			assert(result == VK_SUCCESS && "Failed to reset secondary command pool.");
+			rPool.usedCount = 0;
+		}
+	}
+
+	std::span<const VkCommandBuffer> ParallelCommandRecorder::Record(const VkCommandBufferInheritanceRenderingInfo& crInheritanceRenderingInfo,
+		std::span<const RecordFunction> tasks)
+	{
+		assert(m_pJobSystem->GetCurrentThreadIndex() == 0 && "Secondaries must be recorded from the job system's creating thread.");
+
+		m_RecordedCommandBuffers.assign(tasks.size(), VK_NULL_HANDLE);
+
+		VkCommandBufferInheritanceInfo commandBufferInheritanceInfo{};
+		commandBufferInheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		commandBufferInheritanceInfo.pNext = &crInheritanceRenderingInfo;
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo{};
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+		commandBufferBeginInfo.pInheritanceInfo = &commandBufferInheritanceInfo;
+
+		// One job per task, so uneven tasks still balance across threads. Each job records with the pool
+		// of whichever thread runs it, since a thread runs one job at a time. Jobs end up in the shared queue
+		// once the creating thread's deque is full, where threads outside the job system can take them, so
+		// those threads take turns with the frame's last pool instead.
+		core::JobCounter counter;
+		for (size_t i = 0; i < tasks.size(); i++)
+		{
+			m_pJobSystem->Schedule([this, &commandBufferBeginInfo, &crTask = tasks[i], i]()
+			{
+				PROFILE_SCOPE("Record Render Task");
+				std::vector<ThreadCommandPool>& rFramePools = m_CommandPools[m_FrameIndex];
+				uint32_t threadIndex = m_pJobSystem->GetCurrentThreadIndex();
+				std::unique_lock<std::mutex> outsideThreadLock;
+				if (threadIndex == UINT32_MAX)
+				{
+					threadIndex = static_cast<uint32_t>(rFramePools.size() - 1);
+					outsideThreadLock = std::unique_lock(m_OutsideThreadPoolMutex);
+				}
+				ThreadCommandPool& rPool = rFramePools[threadIndex];
+				VkCommandBuffer pCommandBuffer = AcquireCommandBuffer(rPool);
+
+				VkResult result = m_cpDispatch->vkBeginCommandBuffer(pCommandBuffer, &commandBufferBeginInfo);
+				assert(result == VK_SUCCESS && "Failed to begin secondary command buffer.");
+				crTask(pCommandBuffer);
+				result = m_cpDispatch->vkEndCommandBuffer(pCommandBuffer);
+				assert(result == VK_SUCCESS && "Failed to end secondary command buffer.");
+
+				m_RecordedCommandBuffers[i] = pCommandBuffer;
+			}, &counter);
+		}
+		m_pJobSystem->Wait(counter);
+
+		return m_RecordedCommandBuffers;
+	}
+
+	VkCommandBuffer ParallelCommandRecorder::AcquireCommandBuffer(ThreadCommandPool& rPool)
+	{
+		if (rPool.usedCount == rPool.commandBuffers.size())
+		{
+			VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+			commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			commandBufferAllocateInfo.commandPool = rPool.pCommandPool;
+			commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			commandBufferAllocateInfo.commandBufferCount = 1;
+
+			VkCommandBuffer pCommandBuffer;
+			VkResult result = m_cpDispatch->vkAllocateCommandBuffers(m_pDevice, &commandBufferAllocateInfo, &pCommandBuffer);
+			assert(result == VK_SUCCESS && "Failed to allocate secondary command buffer.");
+			rPool.commandBuffers.push_back(pCommandBuffer);
+		}
+
+		return rPool.commandBuffers[rPool.usedCount++];
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Core/JobSystem.h"
+#include "Rendering/DeviceDispatch.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace rendering
+{
+	// Records secondary command buffers as jobs, for the main thread to execute in its frame's primary.
+	// Every job system thread owns one VkCommandPool per frame in flight, so recording never contends on a pool,
+	// and a frame's pools are reset as a whole once the frame's submission is done. Threads outside the job system
+	// can still pick up a record job from its shared queue, so they share one more pool per frame behind a lock.
+	class ParallelCommandRecorder
+	{
+	public:
+		using RecordFunction = std::function<void(VkCommandBuffer pCommandBuffer)>;
+	public:
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, uint32_t queueFamilyIndex, uint32_t frameCount, core::JobSystem& rJobSystem);
+		void Destroy();
+
+		// Resets the frame's pools. The GPU must be done with everything previously recorded for this frame.
+		void BeginFrame(uint32_t frameIndex);
+
+		// Records every task into its own secondary command buffer, which continues the primary's dynamic rendering
+		// with the inherited attachment formats. Must be called from the thread that created the job system, which
+		// helps record until every task is done. Returns the secondaries in task order, valid until the next call.
+		std::span<const VkCommandBuffer> Record(const VkCommandBufferInheritanceRenderingInfo& crInheritanceRenderingInfo,
+			std::span<const RecordFunction> tasks);
+	private:
+		struct ThreadCommandPool
+		{
+			VkCommandPool pCommandPool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> commandBuffers;
+			uint32_t usedCount = 0;
+		};
+	private:
+		VkCommandBuffer AcquireCommandBuffer(ThreadCommandPool& rPool);
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		core::JobSystem* m_pJobSystem = nullptr;
+		uint32_t m_FrameIndex = 0;
+
+		// Indexed by frame, then job system thread. The last pool of each frame is for threads outside the job system.
+		std::vector<std::vector<ThreadCommandPool>> m_CommandPools;
+		// Held while a thread outside the job system records with its frame's pool.
+		std::mutex m_OutsideThreadPoolMutex;
+		std::vector<VkCommandBuffer> m_RecordedCommandBuffers;
+	};
+}
@@ -0,0 +1,166 @@
+#include "Rendering/PipelineCache.h"
+#include "Core/Profiler.h"
+#include <assert.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace rendering
+{
+	void PipelineCache::Load(const VkPhysicalDeviceProperties& crPhysicalDeviceProperties, const std::filesystem::path& crDirectory)
+	{
+		PROFILE_FUNCTION();
+
+		m_PhysicalDeviceProperties = crPhysicalDeviceProperties;
+
+		// Separate files per device, so switching between GPUs doesn't throw away the other one's cache.
+		char filename[64];
+		snprintf(filename, sizeof(filename), "PipelineCache-%08x-%08x.bin", crPhysicalDeviceProperties.vendorID, crPhysicalDeviceProperties.deviceID);
+		m_Filepath = crDirectory / filename;
+
+		// A missing, stale or corrupt file just means starting with an empty cache.
+		m_InitialData.clear();
+		if (std::ifstream file{ m_Filepath, std::ios::binary | std::ios::ate })
+		{
+			size_t fileSize = static_cast<size_t>(file.tellg());
+			file.seekg(0);
+
+			FileHeader expectedHeader = MakeFileHeader();
+			FileHeader header{};
+			if (fileSize >= sizeof(FileHeader) && file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader)) &&
+				header.dataSize == fileSize - sizeof(FileHeader) &&
+				memcmp(&header, &expectedHeader, offsetof(FileHeader, dataSize)) == 0)
+			{
+				m_InitialData.resize(static_cast<size_t>(header.dataSize));
+				if (!file.read(m_InitialData.data(), m_InitialData.size()) || HashData(m_InitialData.data(), m_InitialData.size()) != header.dataHash)
+					m_InitialData.clear();
+			}
+
+#if !CONFIG_DIST // ENABLE_LOGGING
+			if (m_InitialData.empty())
+				std::cerr << "Discarding stale or corrupt pipeline cache \"" << m_Filepath.string() << "\".\n";
+#endif
+		}
+	}
+
+	void PipelineCache::Create(VkDevice pDevice, const DeviceDispatch& crDispatch)
+	{
+		PROFILE_FUNCTION();
+
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+
+		VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+		pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		pipelineCacheCreateInfo.initialDataSize = m_InitialData.size();
+		pipelineCacheCreateInfo.pInitialData = m_InitialData.data();
+
+		VkResult result = m_cpDispatch->vkCreatePipelineCache(m_pDevice, &pipelineCacheCreateInfo, m_cpDispatch->cpAllocationCallbacks, &m_pPipelineCache);
+		assert(result == VK_SUCCESS && "Failed to create pipeline cache.");
+
+		// The driver has its own copy now.
+		m_InitialData.clear();
+		m_InitialData.shrink_to_fit();
+	}
+
+	void PipelineCache::Destroy()
+	{
+		m_cpDispatch->vkDestroyPipelineCache(m_pDevice, m_pPipelineCache, m_cpDispatch->cpAllocationCallbacks);
+		m_pPipelineCache = VK_NULL_HANDLE;
+	}
+
+	void PipelineCache::Save()
+	{
+		PROFILE_FUNCTION();
+
+		std::vector<char> data;
+		{
+			std::lock_guard lock(m_MergeMutex);
+
+			size_t dataSize;
+			VkResult result = m_cpDispatch->vkGetPipelineCacheData(m_pDevice, m_pPipelineCache, &dataSize, nullptr);
+			assert(result == VK_SUCCESS && "Failed to get pipeline cache data size.");
+			data.resize(dataSize);
+			result = m_cpDispatch->vkGetPipelineCacheData(m_pDevice, m_pPipelineCache, &dataSize, data.data());
+			assert((result == VK_SUCCESS || result == VK_INCOMPLETE) && "Failed to get pipeline cache data.");
+			data.resize(dataSize);
+		}
+
+		if (data.empty())
+			return;
+
+		FileHeader header = MakeFileHeader();
+		header.dataSize = data.size();
+		header.dataHash = HashData(data.data(), data.size());
+
+		std::error_code error;
+		std::filesystem::create_directories(m_Filepath.parent_path(), error);
+
+		std::filesystem::path temporaryFilepath = m_Filepath;
+		temporaryFilepath += ".tmp";
+		{
+			std::ofstream file{ temporaryFilepath, std::ios::binary | std::ios::trunc };
+			if (!file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader)) || !file.write(data.data(), data.size()))
+				error = std::make_error_code(std::errc::io_error);
+		}
+
+		if (!error)
+			std::filesystem::rename(temporaryFilepath, m_Filepath, error);
+
+		if (error)
+		{
+#if !CONFIG_DIST // ENABLE_LOGGING
+			std::cerr << "Failed to save pipeline cache \"" << m_Filepath.string() << "\": " << error.message() << '\n';
+#endif
+			std::filesystem::remove(temporaryFilepath, error);
+		}
+	}
+
+	VkPipelineCache PipelineCache::CreateWorkerCache()
+	{
+		VkPipelineCacheCreateInfo pipelineCacheCreateInfo{};
+		pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+		VkPipelineCache pWorkerCache;
+		VkResult result = m_cpDispatch->vkCreatePipelineCache(m_pDevice, &pipelineCacheCreateInfo, m_cpDispatch->cpAllocationCallbacks, &pWorkerCache);
+		assert(result == VK_SUCCESS && "Failed to create worker pipeline cache.");
+		return pWorkerCache;
+	}
+
+	void PipelineCache::MergeWorkerCache(VkPipelineCache pWorkerCache)
+	{
+		{
+			// The destination cache must be externally synchronized for merges.
+			std::lock_guard lock(m_MergeMutex);
+			VkResult result = m_cpDispatch->vkMergePipelineCaches(m_pDevice, m_pPipelineCache, 1, &pWorkerCache);
+			assert(result == VK_SUCCESS && "Failed to merge worker pipeline cache.");
+		}
+
+		m_cpDispatch->vkDestroyPipelineCache(m_pDevice, pWorkerCache, m_cpDispatch->cpAllocationCallbacks);
+	}
+
+	PipelineCache::FileHeader PipelineCache::MakeFileHeader() const
+	{
+		FileHeader header{};
+		header.magic = FILE_MAGIC;
+		header.version = FILE_VERSION;
+		header.vendorID = m_PhysicalDeviceProperties.vendorID;
+		header.deviceID = m_PhysicalDeviceProperties.deviceID;
+		header.driverVersion = m_PhysicalDeviceProperties.driverVersion;
+		memcpy(header.pipelineCacheUUID, m_PhysicalDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+		return header;
+	}
+
+	uint64_t PipelineCache::HashData(const void* cpData, size_t size)
+	{
+		// FNV-1a, only needs to catch truncated or corrupted files.
+		uint64_t hash = 0xCBF29CE484222325;
+		const uint8_t* cpBytes = static_cast<const uint8_t*>(cpData);
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ cpBytes[i]) * 0x100000001B3;
+		return hash;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Rendering/DeviceDispatch.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <filesystem>
+#include <mutex>
+#include <vector>
+
+namespace rendering
+{
+	// A VkPipelineCache that's loaded from and saved to disk, so later launches skip driver shader compilation.
+	// The file is only used if it was written by the same device, driver version and pipeline cache UUID.
+	class PipelineCache
+	{
+	public:
+		// Reads the file saved by the last run on this device. Makes no Vulkan calls, so it can run on a worker thread
+		// while the device is being created.
+		void Load(const VkPhysicalDeviceProperties& crPhysicalDeviceProperties, const std::filesystem::path& crDirectory);
+		// Creates the cache from what Load() read.
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch);
+		void Destroy();
+
+		// Writes to a temporary file first and renames it over the old one, so a crash can never leave a torn file behind.
+		void Save();
+
+		inline VkPipelineCache Get() const noexcept { return m_pPipelineCache; }
+
+		// Worker threads should create pipelines into their own cache, to avoid contending on the main cache's
+		// internal lock, and merge it back when they're done. The worker cache is destroyed by the merge.
+		VkPipelineCache CreateWorkerCache();
+		void MergeWorkerCache(VkPipelineCache pWorkerCache);
+	private:
+		struct FileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			uint32_t reserved; // Keeps the struct free of padding, since it's compared with memcmp.
+			uint64_t dataSize;
+			uint64_t dataHash;
+		};
+
+		static constexpr uint32_t FILE_MAGIC = 0x4350564C; // "LVPC"
+		static constexpr uint32_t FILE_VERSION = 1;
+	private:
+		FileHeader MakeFileHeader() const;
+		static uint64_t HashData(const void* cpData, size_t size);
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		VkPhysicalDeviceProperties m_PhysicalDeviceProperties{};
+		std::filesystem::path m_Filepath;
+		// Only held between Load() and Create().
+		std::vector<char> m_InitialData;
+		VkPipelineCache m_pPipelineCache = VK_NULL_HANDLE;
+		std::mutex m_MergeMutex;
+	};
+}
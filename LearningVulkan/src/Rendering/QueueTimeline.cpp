@@ -0,0 +1,77 @@
+#include "Rendering/QueueTimeline.h"
+#include <assert.h>
+
+namespace rendering
+{
+	void QueueTimeline::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, SubmitBatcher& rBatcher, uint32_t queueFamilyIndex)
+	{
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_pBatcher = &rBatcher;
+		m_QueueFamilyIndex = queueFamilyIndex;
+		m_pSemaphore = CreateTimelineSemaphore(*m_cpDispatch, m_pDevice);
+		m_LastSubmittedValue = 0;
+		m_FlushedValue = 0;
+		m_CompletedValue = 0;
+	}
+
+	void QueueTimeline::Destroy()
+	{
+		Wait(GetLastSubmittedValue());
+		m_cpDispatch->vkDestroySemaphore(m_pDevice, m_pSemaphore, m_cpDispatch->cpAllocationCallbacks);
+		m_pSemaphore = VK_NULL_HANDLE;
+	}
+
+	uint64_t QueueTimeline::Enqueue(std::span<const VkCommandBufferSubmitInfo> commandBuffers, std::span<const VkSemaphoreSubmitInfo> waits,
+		std::span<const VkSemaphoreSubmitInfo> signals)
+	{
+		return m_pBatcher->Add(*this, commandBuffers, waits, signals);
+	}
+
+	uint64_t QueueTimeline::Submit(std::span<const VkCommandBufferSubmitInfo> commandBuffers, std::span<const VkSemaphoreSubmitInfo> waits,
+		std::span<const VkSemaphoreSubmitInfo> signals)
+	{
+		uint64_t value = Enqueue(commandBuffers, waits, signals);
+		m_pBatcher->Flush();
+		return value;
+	}
+
+	void QueueTimeline::Wait(uint64_t value)
+	{
+		if (value <= m_CompletedValue.load(std::memory_order_acquire))
+			return;
+
+		// Waiting on a value that was never submitted would never return.
+		if (value > m_FlushedValue.load(std::memory_order_acquire))
+			m_pBatcher->Flush();
+
+		WaitTimelineSemaphore(*m_cpDispatch, m_pDevice, m_pSemaphore, value);
+
+		uint64_t completedValue = m_CompletedValue.load(std::memory_order_relaxed);
+		while (value > completedValue && !m_CompletedValue.compare_exchange_weak(completedValue, value, std::memory_order_release));
+	}
+
+	bool QueueTimeline::IsComplete(uint64_t value)
+	{
+		return value <= m_CompletedValue.load(std::memory_order_acquire) || value <= GetCompletedValue();
+	}
+
+	uint64_t QueueTimeline::GetCompletedValue()
+	{
+		uint64_t value = GetTimelineSemaphoreValue(*m_cpDispatch, m_pDevice, m_pSemaphore);
+
+		uint64_t completedValue = m_CompletedValue.load(std::memory_order_relaxed);
+		while (value > completedValue && !m_CompletedValue.compare_exchange_weak(completedValue, value, std::memory_order_release));
+		return value;
+	}
+
+	VkSemaphoreSubmitInfo QueueTimeline::GetWaitInfo(const TimelineWait& crWait)
+	{
+		VkSemaphoreSubmitInfo semaphoreSubmitInfo{};
+		semaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		semaphoreSubmitInfo.semaphore = crWait.pSemaphore;
+		semaphoreSubmitInfo.value = crWait.value;
+		semaphoreSubmitInfo.stageMask = crWait.stageMask;
+		return semaphoreSubmitInfo;
+	}
+}
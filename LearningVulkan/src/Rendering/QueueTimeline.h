@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Rendering/SubmitBatcher.h"
+#include "Rendering/Timeline.h"
+#include <atomic>
+#include <span>
+
+namespace rendering
+{
+	// Owns a timeline semaphore that every submission through it signals with the next value, so the CPU can wait on
+	// or poll any submission, and other queues can wait on it on the GPU, without fences. Several timelines may share
+	// one queue (e.g. when there's no separate transfer family), and all of them go through the queue's SubmitBatcher.
+	// All functions are thread safe.
+	class QueueTimeline
+	{
+	public:
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, SubmitBatcher& rBatcher, uint32_t queueFamilyIndex);
+		// Waits for everything submitted to finish.
+		void Destroy();
+
+		// Adds one batch to the queue's batcher that also signals the returned value once it's done.
+		// It's submitted with everything else on the queue by the batcher's next flush.
+		uint64_t Enqueue(std::span<const VkCommandBufferSubmitInfo> commandBuffers, std::span<const VkSemaphoreSubmitInfo> waits = {},
+			std::span<const VkSemaphoreSubmitInfo> signals = {});
+		// Enqueues, then flushes the queue's batcher right away.
+		uint64_t Submit(std::span<const VkCommandBufferSubmitInfo> commandBuffers, std::span<const VkSemaphoreSubmitInfo> waits = {},
+			std::span<const VkSemaphoreSubmitInfo> signals = {});
+
+		// Blocks until the value has been signaled, flushing the batcher (and its dependencies) first if it hasn't been
+		// submitted yet.
+		// Returns immediately if it's known to have been signaled already.
+		void Wait(uint64_t value);
+		bool IsComplete(uint64_t value);
+		uint64_t GetCompletedValue();
+
+		// The value the next Enqueue() will signal. Only stable if the caller is the only one submitting.
+		inline uint64_t GetNextValue() const noexcept { return m_LastSubmittedValue.load(std::memory_order_acquire) + 1; }
+		// Includes batches that haven't been flushed yet.
+		inline uint64_t GetLastSubmittedValue() const noexcept { return m_LastSubmittedValue.load(std::memory_order_acquire); }
+		inline TimelinePoint GetNextPoint() const noexcept { return { m_pSemaphore, GetNextValue() }; }
+
+		inline VkSemaphore GetSemaphore() const noexcept { return m_pSemaphore; }
+		inline SubmitBatcher& GetBatcher() const noexcept { return *m_pBatcher; }
+		inline uint32_t GetQueueFamilyIndex() const noexcept { return m_QueueFamilyIndex; }
+
+		static VkSemaphoreSubmitInfo GetWaitInfo(const TimelineWait& crWait);
+	private:
+		friend class SubmitBatcher;
+
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		SubmitBatcher* m_pBatcher = nullptr;
+		uint32_t m_QueueFamilyIndex = 0;
+
+		VkSemaphore m_pSemaphore = VK_NULL_HANDLE;
+		// Both only written by the batcher, under its lock.
+		std::atomic<uint64_t> m_LastSubmittedValue = 0;
+		std::atomic<uint64_t> m_FlushedValue = 0;
+		// Cached, so polling already finished values doesn't call into the driver.
+		std::atomic<uint64_t> m_CompletedValue = 0;
+	};
+}
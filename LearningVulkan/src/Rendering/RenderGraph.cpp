@@ -0,0 +1,751 @@
+#include "Rendering/RenderGraph.h"
+#include "Core/Profiler.h"
+#include "Rendering/Memory.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+namespace rendering
+{
+	struct UsageInfo
+	{
+		VkPipelineStageFlags2 stageMask;
+		VkAccessFlags2 accessMask;
+		VkImageLayout layout;
+		bool reads;
+		bool writes;
+	};
+
+	static constexpr VkAccessFlags2 WRITE_ACCESS_MASK = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+		VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+	static UsageInfo GetUsageInfo(ResourceUsage usage)
+	{
+		static constexpr VkPipelineStageFlags2 FRAGMENT_TESTS_STAGE_MASK = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+		switch (usage)
+		{
+			case ResourceUsage::ColorAttachmentWrite:
+				return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, false, true };
+			case ResourceUsage::ColorAttachmentReadWrite:
+				return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+					VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, true };
+			case ResourceUsage::DepthStencilAttachmentWrite:
+				// Depth tests read what the pass itself cleared, but nothing from before it.
+				return { FRAGMENT_TESTS_STAGE_MASK, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, false, true };
+			case ResourceUsage::DepthStencilAttachmentRead:
+				return { FRAGMENT_TESTS_STAGE_MASK, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, true, false };
+			case ResourceUsage::FragmentShaderRead:
+				return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, true, false };
+			case ResourceUsage::ComputeShaderRead:
+				return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, true, false };
+			case ResourceUsage::ComputeShaderWrite:
+				return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, false, true };
+			case ResourceUsage::TransferRead:
+				return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, true, false };
+			case ResourceUsage::TransferWrite:
+				return { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, false, true };
+			case ResourceUsage::HostRead:
+				return { VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, true, false };
+			case ResourceUsage::Present:
+				// Presentation is synchronized by the render finished semaphore, which is signaled at all commands, so the
+				// transition only has to happen before it.
+				return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, true, false };
+		}
+		assert(false && "Unknown resource usage.");
+		return {};
+	}
+
+	static VkImageUsageFlags GetImageUsage(ResourceUsage usage)
+	{
+		switch (usage)
+		{
+			case ResourceUsage::ColorAttachmentWrite:
+			case ResourceUsage::ColorAttachmentReadWrite:
+				return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+			case ResourceUsage::DepthStencilAttachmentWrite:
+			case ResourceUsage::DepthStencilAttachmentRead:
+				return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+			case ResourceUsage::FragmentShaderRead:
+				return VK_IMAGE_USAGE_SAMPLED_BIT;
+			case ResourceUsage::ComputeShaderRead:
+			case ResourceUsage::ComputeShaderWrite:
+				return VK_IMAGE_USAGE_STORAGE_BIT;
+			case ResourceUsage::TransferRead:
+				return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			case ResourceUsage::TransferWrite:
+				return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			default:
+				return 0;
+		}
+	}
+
+	static bool IsSameTransientImage(const TransientImageDescription& crA, VkImageUsageFlags usageA, const TransientImageDescription& crB, VkImageUsageFlags usageB)
+	{
+		return crA.format == crB.format && crA.extent.width == crB.extent.width && crA.extent.height == crB.extent.height &&
+			crA.aspectMask == crB.aspectMask && crA.samples == crB.samples && usageA == usageB;
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::Use(RenderResource resource, ResourceUsage usage)
+	{
+		assert(m_PassIndex + 1 == m_rGraph.m_Passes.size() && "Render pass resource uses must be declared before the next pass is added.");
+		assert(resource < m_rGraph.m_Resources.size() && "Unknown render graph resource.");
+		assert(usage != ResourceUsage::HostRead && usage != ResourceUsage::Present && "Usage is only valid as an export's final usage.");
+
+		Pass& rPass = m_rGraph.m_Passes[m_PassIndex];
+#ifndef NDEBUG
+		for (uint32_t i = 0; i < rPass.accessCount; i++)
+			assert(m_rGraph.m_Accesses[rPass.firstAccess + i].resource != resource && "A render pass may only use a resource one way.");
+#endif
+		m_rGraph.m_Accesses.push_back({ resource, usage });
+		rPass.accessCount++;
+		return *this;
+	}
+
+	RenderGraph::PassBuilder& RenderGraph::PassBuilder::SetSideEffects()
+	{
+		m_rGraph.m_Passes[m_PassIndex].sideEffects = true;
+		return *this;
+	}
+
+	void RenderGraph::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, DeviceAllocator& rAllocator, DeletionQueue& rDeletionQueue)
+	{
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_pAllocator = &rAllocator;
+		m_pDeletionQueue = &rDeletionQueue;
+	}
+
+	void RenderGraph::Destroy()
+	{
+		for (TransientImage& rImage : m_TransientImages)
+		{
+			m_cpDispatch->vkDestroyImageView(m_pDevice, rImage.pImageView, m_cpDispatch->cpAllocationCallbacks);
+			m_cpDispatch->vkDestroyImage(m_pDevice, rImage.pImage, m_cpDispatch->cpAllocationCallbacks);
+			if (rImage.dedicated)
+				m_pAllocator->Free(rImage.dedicatedAllocation);
+		}
+		if (m_TransientAllocation.pMemory != VK_NULL_HANDLE)
+			m_pAllocator->Free(m_TransientAllocation);
+		if (m_LazyTransientAllocation.pMemory != VK_NULL_HANDLE)
+			m_pAllocator->Free(m_LazyTransientAllocation);
+		m_TransientImages = {};
+		m_RequestedTransientImages = {};
+
+		// Releases whatever last frame's passes captured.
+		m_Passes = {};
+		m_Resources = {};
+		m_Accesses = {};
+		m_BarrierBatches = {};
+		m_MemoryBarriers = {};
+		m_ImageBarriers = {};
+	}
+
+	void RenderGraph::Reset()
+	{
+		m_Resources.clear();
+		m_Passes.clear();
+		m_Accesses.clear();
+		m_BarrierBatches.clear();
+		m_MemoryBarriers.clear();
+		m_ImageBarriers.clear();
+		m_RequestedTransientImages.clear();
+		m_CulledPassCount = 0;
+		m_Compiled = false;
+	}
+
+	RenderResource RenderGraph::ImportImage(const char* cpName, VkImage pImage, VkImageAspectFlags aspectMask, const ImageState& crInitialState)
+	{
+		Resource& rResource = m_Resources.emplace_back();
+		rResource.cpName = cpName;
+		rResource.pImage = pImage;
+		rResource.aspectMask = aspectMask;
+		rResource.layout = crInitialState.layout;
+		rResource.writeStageMask = crInitialState.stageMask;
+		rResource.writeAccessMask = crInitialState.accessMask;
+		return static_cast<RenderResource>(m_Resources.size() - 1);
+	}
+
+	RenderResource RenderGraph::ImportBuffer(const char* cpName, VkBuffer pBuffer)
+	{
+		Resource& rResource = m_Resources.emplace_back();
+		rResource.cpName = cpName;
+		rResource.pBuffer = pBuffer;
+		return static_cast<RenderResource>(m_Resources.size() - 1);
+	}
+
+	RenderResource RenderGraph::CreateImage(const char* cpName, const TransientImageDescription& crDescription)
+	{
+		Resource& rResource = m_Resources.emplace_back();
+		rResource.cpName = cpName;
+		rResource.aspectMask = crDescription.aspectMask;
+		rResource.transientIndex = static_cast<uint32_t>(m_RequestedTransientImages.size());
+
+		TransientImage& rImage = m_RequestedTransientImages.emplace_back();
+		rImage.description = crDescription;
+		rImage.resource = static_cast<RenderResource>(m_Resources.size() - 1);
+		rImage.firstPass = UINT32_MAX;
+		return rImage.resource;
+	}
+
+	void RenderGraph::Export(RenderResource resource)
+	{
+		assert(m_Resources[resource].transientIndex == UINT32_MAX && "Transient images can't be exported.");
+		m_Resources[resource].exported = true;
+	}
+
+	void RenderGraph::Export(RenderResource resource, ResourceUsage finalUsage)
+	{
+		Resource& rResource = m_Resources[resource];
+		assert(rResource.transientIndex == UINT32_MAX && "Transient images can't be exported.");
+		rResource.exported = true;
+		rResource.hasFinalUsage = true;
+		rResource.finalUsage = finalUsage;
+	}
+
+	RenderGraph::PassBuilder RenderGraph::AddPass(const char* cpName, ExecuteFunction execute)
+	{
+		Pass& rPass = m_Passes.emplace_back();
+		rPass.cpName = cpName;
+		rPass.execute = std::move(execute);
+		rPass.firstAccess = static_cast<uint32_t>(m_Accesses.size());
+		return PassBuilder(*this, static_cast<uint32_t>(m_Passes.size() - 1));
+	}
+
+	void RenderGraph::Compile(const TimelinePoint& crFramePoint)
+	{
+		PROFILE_FUNCTION();
+
+		assert(!m_Compiled && "Render graph was already compiled.");
+		CullPasses();
+		UpdateTransientImages(crFramePoint);
+
+		for (uint32_t passIndex = 0; passIndex < m_Passes.size(); passIndex++)
+		{
+			Pass& rPass = m_Passes[passIndex];
+			if (rPass.culled)
+				continue;
+
+			rPass.barrierBatch = static_cast<uint32_t>(m_BarrierBatches.size());
+			m_BarrierBatches.push_back({ static_cast<uint32_t>(m_MemoryBarriers.size()), 0, static_cast<uint32_t>(m_ImageBarriers.size()), 0 });
+			for (uint32_t i = 0; i < rPass.accessCount; i++)
+			{
+				const ResourceAccess& crAccess = m_Accesses[rPass.firstAccess + i];
+				Resource& rResource = m_Resources[crAccess.resource];
+				if (rResource.transientIndex != UINT32_MAX && m_TransientImages[rResource.transientIndex].firstPass == passIndex)
+				{
+					UsageInfo info = GetUsageInfo(crAccess.usage);
+					assert(info.writes && !info.reads && "A transient image's first use must discard its contents.");
+					BeginTransientLifetime(rResource);
+				}
+				AddBarriers(rResource, crAccess.usage);
+			}
+		}
+
+		m_FinalBarrierBatch = static_cast<uint32_t>(m_BarrierBatches.size());
+		m_BarrierBatches.push_back({ static_cast<uint32_t>(m_MemoryBarriers.size()), 0, static_cast<uint32_t>(m_ImageBarriers.size()), 0 });
+		for (Resource& rResource : m_Resources)
+			if (rResource.hasFinalUsage)
+				AddBarriers(rResource, rResource.finalUsage);
+
+		for (TransientImage& rImage : m_TransientImages)
+		{
+			const Resource& crResource = m_Resources[rImage.resource];
+			rImage.state = { crResource.layout, crResource.writeStageMask | crResource.readStageMask, crResource.writeAccessMask };
+		}
+
+		m_Compiled = true;
+	}
+
+	void RenderGraph::Execute(VkCommandBuffer pCommandBuffer)
+	{
+		PROFILE_FUNCTION();
+
+		assert(m_Compiled && "Render graph must be compiled before it's executed.");
+		for (Pass& rPass : m_Passes)
+		{
+			if (rPass.culled)
+				continue;
+
+			RecordBarriers(pCommandBuffer, m_BarrierBatches[rPass.barrierBatch]);
+			rPass.execute(pCommandBuffer);
+		}
+		RecordBarriers(pCommandBuffer, m_BarrierBatches[m_FinalBarrierBatch]);
+	}
+
+	VkImage RenderGraph::GetImage(RenderResource resource) const
+	{
+		const Resource& crResource = m_Resources[resource];
+		assert((crResource.transientIndex == UINT32_MAX || m_Compiled) && "Transient images only exist once the render graph is compiled.");
+		return crResource.pImage;
+	}
+
+	VkImageView RenderGraph::GetImageView(RenderResource resource) const
+	{
+		const Resource& crResource = m_Resources[resource];
+		assert(m_Compiled && crResource.transientIndex != UINT32_MAX && "Only compiled transient images have views.");
+		return m_TransientImages[crResource.transientIndex].pImageView;
+	}
+
+	ImageState RenderGraph::GetFinalState(RenderResource resource) const
+	{
+		assert(m_Compiled && "Render graph must be compiled before its final states are known.");
+		const Resource& crResource = m_Resources[resource];
+		assert(crResource.pImage != VK_NULL_HANDLE && "Only images have a final state.");
+		return { crResource.layout, crResource.writeStageMask | crResource.readStageMask, crResource.writeAccessMask };
+	}
+
+	void RenderGraph::PrintTransientMemoryStatistics(std::ostream& rStream, const TransientMemoryStatistics& crStatistics)
+	{
+		char line[160];
+		std::snprintf(line, sizeof(line), "transient images: %u, %.1f MiB aliased into %.1f MiB (%.1f MiB lazily allocated)\n", crStatistics.imageCount,
+			crStatistics.requiredBytes / 1048576.0, crStatistics.allocatedBytes / 1048576.0, crStatistics.lazilyAllocatedBytes / 1048576.0);
+		rStream << line;
+		std::snprintf(line, sizeof(line), "transient peak: %.1f MiB aliased into %.1f MiB, %.1f MiB saved\n", crStatistics.peakRequiredBytes / 1048576.0,
+			crStatistics.peakAllocatedBytes / 1048576.0, (crStatistics.peakRequiredBytes - crStatistics.peakAllocatedBytes) / 1048576.0);
+		rStream << line;
+	}
+
+	void RenderGraph::CullPasses()
+	{
+		// Walks backwards from the exports, keeping every pass that writes something a kept pass (or an export) needs.
+		for (Resource& rResource : m_Resources)
+			rResource.needed = rResource.exported;
+
+		for (size_t i = m_Passes.size(); i-- > 0;)
+		{
+			Pass& rPass = m_Passes[i];
+			bool live = rPass.sideEffects;
+			for (uint32_t j = 0; j < rPass.accessCount && !live; j++)
+			{
+				const ResourceAccess& crAccess = m_Accesses[rPass.firstAccess + j];
+				live = GetUsageInfo(crAccess.usage).writes && m_Resources[crAccess.resource].needed;
+			}
+
+			rPass.culled = !live;
+			if (!live)
+			{
+				m_CulledPassCount++;
+				continue;
+			}
+
+			for (uint32_t j = 0; j < rPass.accessCount; j++)
+			{
+				const ResourceAccess& crAccess = m_Accesses[rPass.firstAccess + j];
+				UsageInfo info = GetUsageInfo(crAccess.usage);
+				// Nothing earlier has to write a resource whose contents this pass discards.
+				if (info.writes && !info.reads)
+					m_Resources[crAccess.resource].needed = false;
+				else if (info.reads)
+					m_Resources[crAccess.resource].needed = true;
+			}
+		}
+	}
+
+	void RenderGraph::UpdateTransientImages(const TimelinePoint& crFramePoint)
+	{
+		// Lifetimes and usage only count passes that weren't culled.
+		for (uint32_t passIndex = 0; passIndex < m_Passes.size(); passIndex++)
+		{
+			const Pass& crPass = m_Passes[passIndex];
+			if (crPass.culled)
+				continue;
+
+			for (uint32_t i = 0; i < crPass.accessCount; i++)
+			{
+				const ResourceAccess& crAccess = m_Accesses[crPass.firstAccess + i];
+				uint32_t transientIndex = m_Resources[crAccess.resource].transientIndex;
+				if (transientIndex == UINT32_MAX)
+					continue;
+
+				TransientImage& rImage = m_RequestedTransientImages[transientIndex];
+				rImage.firstPass = std::min(rImage.firstPass, passIndex);
+				rImage.lastPass = passIndex;
+				rImage.usage |= GetImageUsage(crAccess.usage);
+			}
+		}
+
+		// Images only used by culled passes are never created.
+		std::erase_if(m_RequestedTransientImages, [this](const TransientImage& crImage)
+		{
+			if (crImage.firstPass != UINT32_MAX)
+				return false;
+			m_Resources[crImage.resource].transientIndex = UINT32_MAX;
+			return true;
+		});
+
+		// Attachments that are never read outside their pass don't need to be backed by memory on tilers.
+		static constexpr VkImageUsageFlags ATTACHMENT_USAGE = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+		for (TransientImage& rImage : m_RequestedTransientImages)
+			if ((rImage.usage & ~ATTACHMENT_USAGE) == 0)
+				rImage.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+		bool reusable = m_RequestedTransientImages.size() == m_TransientImages.size();
+		for (size_t i = 0; i < m_RequestedTransientImages.size() && reusable; i++)
+		{
+			const TransientImage& crRequested = m_RequestedTransientImages[i];
+			const TransientImage& crExisting = m_TransientImages[i];
+			reusable = IsSameTransientImage(crRequested.description, crRequested.usage, crExisting.description, crExisting.usage) &&
+				crRequested.firstPass == crExisting.firstPass && crRequested.lastPass == crExisting.lastPass;
+		}
+
+		if (reusable)
+		{
+			for (size_t i = 0; i < m_TransientImages.size(); i++)
+				m_TransientImages[i].resource = m_RequestedTransientImages[i].resource;
+		}
+		else
+		{
+			RetireTransientImages(crFramePoint);
+			m_TransientImages.swap(m_RequestedTransientImages);
+			CreateTransientImages();
+		}
+
+		for (uint32_t i = 0; i < m_TransientImages.size(); i++)
+		{
+			Resource& rResource = m_Resources[m_TransientImages[i].resource];
+			rResource.transientIndex = i;
+			rResource.pImage = m_TransientImages[i].pImage;
+		}
+	}
+
+	void RenderGraph::CreateTransientImages()
+	{
+		PROFILE_FUNCTION();
+
+		const VkPhysicalDeviceMemoryProperties& crMemoryProperties = m_pAllocator->GetMemoryProperties();
+		uint32_t lazyMemoryTypeBits = 0;
+		for (uint32_t i = 0; i < crMemoryProperties.memoryTypeCount; i++)
+			if (crMemoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+				lazyMemoryTypeBits |= 1 << i;
+
+		VkImageCreateInfo imageCreateInfo{};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.extent.depth = 1;
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		for (TransientImage& rImage : m_TransientImages)
+		{
+			imageCreateInfo.format = rImage.description.format;
+			imageCreateInfo.extent.width = rImage.description.extent.width;
+			imageCreateInfo.extent.height = rImage.description.extent.height;
+			imageCreateInfo.samples = rImage.description.samples;
+			imageCreateInfo.usage = rImage.usage;
+
+			VkResult result = m_cpDispatch->vkCreateImage(m_pDevice, &imageCreateInfo, m_cpDispatch->cpAllocationCallbacks, &rImage.pImage);
+			assert(result == VK_SUCCESS && "Failed to create transient image.");
+
+			VkImageMemoryRequirementsInfo2 imageMemoryRequirementsInfo{};
+			imageMemoryRequirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+			imageMemoryRequirementsInfo.image = rImage.pImage;
+			VkMemoryDedicatedRequirements memoryDedicatedRequirements{};
+			memoryDedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+			VkMemoryRequirements2 memoryRequirements{};
+			memoryRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+			memoryRequirements.pNext = &memoryDedicatedRequirements;
+			m_cpDispatch->vkGetImageMemoryRequirements2(m_pDevice, &imageMemoryRequirementsInfo, &memoryRequirements);
+
+			rImage.size = memoryRequirements.memoryRequirements.size;
+			rImage.alignment = memoryRequirements.memoryRequirements.alignment;
+			rImage.memoryTypeBits = memoryRequirements.memoryRequirements.memoryTypeBits;
+			rImage.lazilyAllocated = (rImage.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) && (rImage.memoryTypeBits & lazyMemoryTypeBits);
+			if (rImage.lazilyAllocated)
+				rImage.memoryTypeBits &= lazyMemoryTypeBits;
+			rImage.dedicated = memoryDedicatedRequirements.requiresDedicatedAllocation;
+			rImage.state = {};
+		}
+
+		TransientMemoryStatistics& rStatistics = m_TransientMemoryStatistics;
+		rStatistics.imageCount = static_cast<uint32_t>(m_TransientImages.size());
+		rStatistics.requiredBytes = 0;
+		rStatistics.allocatedBytes = 0;
+		rStatistics.lazilyAllocatedBytes = 0;
+		for (const TransientImage& crImage : m_TransientImages)
+			rStatistics.requiredBytes += crImage.size;
+
+		// Binding at an offset isn't allowed for these, so each gets its own allocation instead of a place in a heap.
+		for (TransientImage& rImage : m_TransientImages)
+		{
+			if (!rImage.dedicated)
+				continue;
+
+			AllocationCreateInfo allocationCreateInfo;
+			allocationCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | (rImage.lazilyAllocated ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+			allocationCreateInfo.linear = false;
+			allocationCreateInfo.dedicated = true;
+			rImage.dedicatedAllocation = m_pAllocator->AllocateImage(rImage.pImage, allocationCreateInfo);
+
+			rStatistics.allocatedBytes += rImage.size;
+			if (rImage.lazilyAllocated)
+				rStatistics.lazilyAllocatedBytes += rImage.size;
+		}
+
+		// Each heap is one allocation, with the images bound at their offsets in it.
+		for (bool lazilyAllocated : { false, true })
+		{
+			VkMemoryRequirements memoryRequirements{};
+			memoryRequirements.size = PlaceTransientImages(lazilyAllocated, memoryRequirements.alignment, memoryRequirements.memoryTypeBits);
+			if (memoryRequirements.size == 0)
+				continue;
+			assert(memoryRequirements.memoryTypeBits != 0 && "Transient images have no memory type in common.");
+
+			AllocationCreateInfo allocationCreateInfo;
+			allocationCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | (lazilyAllocated ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+			allocationCreateInfo.linear = false;
+			allocationCreateInfo.dedicated = true;
+			Allocation& rAllocation = lazilyAllocated ? m_LazyTransientAllocation : m_TransientAllocation;
+			rAllocation = m_pAllocator->Allocate(memoryRequirements, allocationCreateInfo);
+
+			for (const TransientImage& crImage : m_TransientImages)
+			{
+				if (crImage.dedicated || crImage.lazilyAllocated != lazilyAllocated)
+					continue;
+				VkResult result = m_cpDispatch->vkBindImageMemory(m_pDevice, crImage.pImage, rAllocation.pMemory, rAllocation.offset + crImage.offset);
+				assert(result == VK_SUCCESS && "Failed to bind transient image memory.");
+			}
+
+			rStatistics.allocatedBytes += memoryRequirements.size;
+			if (lazilyAllocated)
+				rStatistics.lazilyAllocatedBytes += memoryRequirements.size;
+		}
+		rStatistics.peakRequiredBytes = std::max(rStatistics.peakRequiredBytes, rStatistics.requiredBytes);
+		rStatistics.peakAllocatedBytes = std::max(rStatistics.peakAllocatedBytes, rStatistics.allocatedBytes);
+
+		VkImageViewCreateInfo imageViewCreateInfo{};
+		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageViewCreateInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+		for (TransientImage& rImage : m_TransientImages)
+		{
+			imageViewCreateInfo.image = rImage.pImage;
+			imageViewCreateInfo.format = rImage.description.format;
+			imageViewCreateInfo.subresourceRange.aspectMask = rImage.description.aspectMask;
+			VkResult result = m_cpDispatch->vkCreateImageView(m_pDevice, &imageViewCreateInfo, m_cpDispatch->cpAllocationCallbacks, &rImage.pImageView);
+			assert(result == VK_SUCCESS && "Failed to create transient image view.");
+		}
+	}
+
+	void RenderGraph::RetireTransientImages(const TimelinePoint& crFramePoint)
+	{
+		// Earlier frames may still be using them.
+		for (const TransientImage& crImage : m_TransientImages)
+		{
+			m_pDeletionQueue->Retire(crFramePoint, crImage.pImageView);
+			m_pDeletionQueue->Retire(crFramePoint, crImage.pImage);
+			if (crImage.dedicated)
+				m_pDeletionQueue->Retire(crFramePoint, crImage.dedicatedAllocation);
+		}
+		if (m_TransientAllocation.pMemory != VK_NULL_HANDLE)
+			m_pDeletionQueue->Retire(crFramePoint, m_TransientAllocation);
+		if (m_LazyTransientAllocation.pMemory != VK_NULL_HANDLE)
+			m_pDeletionQueue->Retire(crFramePoint, m_LazyTransientAllocation);
+		m_TransientAllocation = {};
+		m_LazyTransientAllocation = {};
+		m_TransientImages.clear();
+	}
+
+	VkDeviceSize RenderGraph::PlaceTransientImages(bool lazilyAllocated, VkDeviceSize& rAlignment, uint32_t& rMemoryTypeBits)
+	{
+		std::vector<TransientImage*> images;
+		for (TransientImage& rImage : m_TransientImages)
+			if (!rImage.dedicated && rImage.lazilyAllocated == lazilyAllocated)
+				images.push_back(&rImage);
+
+		// Biggest first, each at the lowest offset where it doesn't overlap anything placed that's alive at the same time.
+		std::stable_sort(images.begin(), images.end(), [](const TransientImage* cpA, const TransientImage* cpB) { return cpA->size > cpB->size; });
+
+		rAlignment = 1;
+		rMemoryTypeBits = ~0u;
+		VkDeviceSize heapSize = 0;
+		std::vector<VkDeviceSize> candidateOffsets;
+		for (size_t i = 0; i < images.size(); i++)
+		{
+			TransientImage& rImage = *images[i];
+			auto overlapsLifetime = [&rImage](const TransientImage* cpOther)
+			{
+				return cpOther->firstPass <= rImage.lastPass && rImage.firstPass <= cpOther->lastPass;
+			};
+
+			candidateOffsets.assign(1, 0);
+			for (size_t j = 0; j < i; j++)
+				if (overlapsLifetime(images[j]))
+					candidateOffsets.push_back(AlignUp(images[j]->offset + images[j]->size, rImage.alignment));
+			std::sort(candidateOffsets.begin(), candidateOffsets.end());
+
+			for (VkDeviceSize offset : candidateOffsets)
+			{
+				bool fits = true;
+				for (size_t j = 0; j < i && fits; j++)
+					fits = !overlapsLifetime(images[j]) || offset + rImage.size <= images[j]->offset || images[j]->offset + images[j]->size <= offset;
+				if (fits)
+				{
+					rImage.offset = offset;
+					break;
+				}
+			}
+
+			heapSize = std::max(heapSize, rImage.offset + rImage.size);
+			rAlignment = std::max(rAlignment, rImage.alignment);
+			rMemoryTypeBits &= rImage.memoryTypeBits;
+		}
+		return heapSize;
+	}
+
+	void RenderGraph::BeginTransientLifetime(Resource& rResource)
+	{
+		const TransientImage& crImage = m_TransientImages[rResource.transientIndex];
+		VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+		for (const TransientImage& crOther : m_TransientImages)
+		{
+			// Images with a dedicated allocation only ever alias themselves.
+			if (crImage.dedicated || crOther.dedicated)
+			{
+				if (&crOther != &crImage)
+					continue;
+			}
+			else if (crOther.lazilyAllocated != crImage.lazilyAllocated || crOther.offset >= crImage.offset + crImage.size || crImage.offset >= crOther.offset + crOther.size)
+				continue;
+
+			// Whatever used the memory earlier this frame is done by now, anything else (including this image) last used it
+			// last frame.
+			if (crOther.lastPass < crImage.firstPass)
+			{
+				const Resource& crOtherResource = m_Resources[crOther.resource];
+				stageMask |= crOtherResource.writeStageMask | crOtherResource.readStageMask;
+				accessMask |= crOtherResource.writeAccessMask;
+			}
+			else
+			{
+				stageMask |= crOther.state.stageMask;
+				accessMask |= crOther.state.accessMask;
+			}
+		}
+
+		rResource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		rResource.writeStageMask = stageMask;
+		rResource.writeAccessMask = accessMask;
+		rResource.readStageMask = VK_PIPELINE_STAGE_2_NONE;
+		rResource.visibleStageMask = VK_PIPELINE_STAGE_2_NONE;
+		rResource.visibleAccessMask = VK_ACCESS_2_NONE;
+	}
+
+	void RenderGraph::AddBarriers(Resource& rResource, ResourceUsage usage)
+	{
+		UsageInfo info = GetUsageInfo(usage);
+
+		if (rResource.pImage != VK_NULL_HANDLE && info.layout != rResource.layout)
+		{
+			VkImageMemoryBarrier2 imageMemoryBarrier{};
+			imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+			// The transition has to wait for every earlier access, and make every earlier write available.
+			imageMemoryBarrier.srcStageMask = rResource.writeStageMask | rResource.readStageMask;
+			imageMemoryBarrier.srcAccessMask = rResource.writeAccessMask;
+			imageMemoryBarrier.dstStageMask = info.stageMask;
+			imageMemoryBarrier.dstAccessMask = info.accessMask;
+			// Discarded contents don't have to be preserved through the transition.
+			imageMemoryBarrier.oldLayout = info.writes && !info.reads ? VK_IMAGE_LAYOUT_UNDEFINED : rResource.layout;
+			imageMemoryBarrier.newLayout = info.layout;
+			imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageMemoryBarrier.image = rResource.pImage;
+			imageMemoryBarrier.subresourceRange.aspectMask = rResource.aspectMask;
+			imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
+			imageMemoryBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+			imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+			imageMemoryBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+			m_ImageBarriers.push_back(imageMemoryBarrier);
+			m_BarrierBatches.back().imageBarrierCount++;
+
+			// The transition itself is a write, already visible to this use. Later uses at other stages still have to
+			// wait for it.
+			rResource.layout = info.layout;
+			rResource.writeStageMask = info.stageMask;
+			rResource.writeAccessMask = info.accessMask & WRITE_ACCESS_MASK;
+			rResource.readStageMask = info.writes ? VK_PIPELINE_STAGE_2_NONE : info.stageMask;
+			rResource.visibleStageMask = info.stageMask;
+			rResource.visibleAccessMask = info.accessMask;
+			return;
+		}
+
+		if (info.writes)
+		{
+			// Write after write, and write after read.
+			VkPipelineStageFlags2 srcStageMask = rResource.writeStageMask | rResource.readStageMask;
+			if (srcStageMask != VK_PIPELINE_STAGE_2_NONE)
+				AddMemoryBarrier(srcStageMask, rResource.writeAccessMask, info.stageMask, info.accessMask);
+
+			rResource.writeStageMask = info.stageMask;
+			rResource.writeAccessMask = info.accessMask & WRITE_ACCESS_MASK;
+			rResource.readStageMask = VK_PIPELINE_STAGE_2_NONE;
+			rResource.visibleStageMask = VK_PIPELINE_STAGE_2_NONE;
+			rResource.visibleAccessMask = VK_ACCESS_2_NONE;
+		}
+		else
+		{
+			// Read after write, unless an earlier read already made the write visible here. Reads after reads need nothing.
+			bool visible = (info.stageMask & ~rResource.visibleStageMask) == 0 && (info.accessMask & ~rResource.visibleAccessMask) == 0;
+			if (rResource.writeStageMask != VK_PIPELINE_STAGE_2_NONE && !visible)
+			{
+				AddMemoryBarrier(rResource.writeStageMask, rResource.writeAccessMask, info.stageMask, info.accessMask);
+				rResource.visibleStageMask |= info.stageMask;
+				rResource.visibleAccessMask |= info.accessMask;
+			}
+			rResource.readStageMask |= info.stageMask;
+		}
+	}
+
+	void RenderGraph::AddMemoryBarrier(VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask)
+	{
+		// Barriers between the same stages are merged, whatever resources they're for.
+		BarrierBatch& rBatch = m_BarrierBatches.back();
+		for (uint32_t i = 0; i < rBatch.memoryBarrierCount; i++)
+		{
+			VkMemoryBarrier2& rMemoryBarrier = m_MemoryBarriers[rBatch.firstMemoryBarrier + i];
+			if (rMemoryBarrier.srcStageMask == srcStageMask && rMemoryBarrier.dstStageMask == dstStageMask)
+			{
+				rMemoryBarrier.srcAccessMask |= srcAccessMask;
+				rMemoryBarrier.dstAccessMask |= dstAccessMask;
+				return;
+			}
+		}
+
+		VkMemoryBarrier2 memoryBarrier{};
+		memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+		memoryBarrier.srcStageMask = srcStageMask;
+		memoryBarrier.srcAccessMask = srcAccessMask;
+		memoryBarrier.dstStageMask = dstStageMask;
+		memoryBarrier.dstAccessMask = dstAccessMask;
+		m_MemoryBarriers.push_back(memoryBarrier);
+		rBatch.memoryBarrierCount++;
+	}
+
+	void RenderGraph::RecordBarriers(VkCommandBuffer pCommandBuffer, const BarrierBatch& crBatch)
+	{
+		if (crBatch.memoryBarrierCount == 0 && crBatch.imageBarrierCount == 0)
+			return;
+
+		VkDependencyInfo dependencyInfo{};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.memoryBarrierCount = crBatch.memoryBarrierCount;
+		dependencyInfo.pMemoryBarriers = m_MemoryBarriers.data() + crBatch.firstMemoryBarrier;
+		dependencyInfo.imageMemoryBarrierCount = crBatch.imageBarrierCount;
+		dependencyInfo.pImageMemoryBarriers = m_ImageBarriers.data() + crBatch.firstImageBarrier;
+		m_cpDispatch->vkCmdPipelineBarrier2(pCommandBuffer, &dependencyInfo);
+	}
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "Rendering/DeletionQueue.h"
+#include "Rendering/DeviceAllocator.h"
+#include "Rendering/DeviceDispatch.h"
+#include "Rendering/Timeline.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+namespace rendering
+{
+	using RenderResource = uint32_t;
+
+	// How a pass uses a resource. Each one implies the stages, accesses and (for images) the layout of the use.
+	enum class ResourceUsage : uint8_t
+	{
+		// The previous contents are discarded, e.g. with VK_ATTACHMENT_LOAD_OP_CLEAR.
+		ColorAttachmentWrite,
+		// The previous contents are loaded, e.g. to draw on top of an earlier pass.
+		ColorAttachmentReadWrite,
+		// The previous contents are discarded.
+		DepthStencilAttachmentWrite,
+		DepthStencilAttachmentRead,
+		FragmentShaderRead,
+		ComputeShaderRead,
+		// The previous contents are discarded.
+		ComputeShaderWrite,
+		TransferRead,
+		// The previous contents are discarded.
+		TransferWrite,
+		// Only valid as an export's final usage.
+		HostRead,
+		// Only valid as an export's final usage.
+		Present
+	};
+
+	// Where an imported image was last left, so its first use in the graph can wait on it and transition from it.
+	struct ImageState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		// Every stage that may still be accessing the image, e.g. the stage a swap chain acquire semaphore is waited on.
+		VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_NONE;
+		// Writes that haven't been made available yet.
+		VkAccessFlags2 accessMask = VK_ACCESS_2_NONE;
+	};
+
+	// An image that only lives within one frame, owned by the render graph. Its usage flags come from how passes use it.
+	struct TransientImageDescription
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+		VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	};
+
+	struct TransientMemoryStatistics
+	{
+		uint32_t imageCount = 0;
+		// What the transient images would take if each had its own memory.
+		VkDeviceSize requiredBytes = 0;
+		// What they take aliased, including lazily allocated memory.
+		VkDeviceSize allocatedBytes = 0;
+		// Only ever backed by physical memory as far as the device needs it, which on tilers may be not at all.
+		VkDeviceSize lazilyAllocatedBytes = 0;
+		// The most either has been over every frame so far, so the savings are the difference.
+		VkDeviceSize peakRequiredBytes = 0;
+		VkDeviceSize peakAllocatedBytes = 0;
+	};
+
+	// Records one frame's passes in order, with every pass declaring how it uses each resource. Compile() culls the
+	// passes whose results are never used and works out the fewest barriers and layout transitions between the rest,
+	// merging each pass's barriers into one vkCmdPipelineBarrier2. Reads of the same layout need nothing between them,
+	// and a write is only made visible to the stages that haven't seen it yet.
+	//
+	// Transient images only live from the first pass that uses them to the last, so images whose lifetimes don't overlap
+	// share memory. Images only ever used as attachments are created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and put
+	// in lazily allocated memory where the device has it. The images and their memory are kept for as long as the frame's
+	// transient images and their lifetimes stay the same, and retired once they change.
+	//
+	// Rebuilt every frame: Reset(), import, create and add passes, Compile(), Execute(). Only used on one thread.
+	class RenderGraph
+	{
+	public:
+		using ExecuteFunction = std::function<void(VkCommandBuffer pCommandBuffer)>;
+
+		// Declares a pass's resource uses. Must be done before the next pass is added.
+		class PassBuilder
+		{
+		public:
+			PassBuilder& Use(RenderResource resource, ResourceUsage usage);
+			// Never culled, e.g. for passes that only write to resources the graph doesn't know about.
+			PassBuilder& SetSideEffects();
+		private:
+			friend class RenderGraph;
+			inline PassBuilder(RenderGraph& rGraph, uint32_t passIndex) noexcept : m_rGraph(rGraph), m_PassIndex(passIndex) {}
+		private:
+			RenderGraph& m_rGraph;
+			uint32_t m_PassIndex;
+		};
+	public:
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, DeviceAllocator& rAllocator, DeletionQueue& rDeletionQueue);
+		// The GPU must be done with every frame.
+		void Destroy();
+
+		// Forgets last frame's passes and resources, keeping the memory.
+		void Reset();
+
+		// Imported images are whole images, with every mip level and array layer used the same way.
+		RenderResource ImportImage(const char* cpName, VkImage pImage, VkImageAspectFlags aspectMask, const ImageState& crInitialState);
+		RenderResource ImportBuffer(const char* cpName, VkBuffer pBuffer);
+		// Its contents are undefined at its first use, which must discard them. Can't be exported.
+		RenderResource CreateImage(const char* cpName, const TransientImageDescription& crDescription);
+
+		// The resource is used after the graph, so the passes writing it aren't culled. The second overload also
+		// transitions it for its next use once every pass is done, e.g. to present a swap chain image.
+		void Export(RenderResource resource);
+		void Export(RenderResource resource, ResourceUsage finalUsage);
+
+		// Passes execute in the order they're added. cpName must be a string literal.
+		PassBuilder AddPass(const char* cpName, ExecuteFunction execute);
+
+		// Transient memory that's no longer needed is retired at crFramePoint, which must be signaled once the frame is done.
+		void Compile(const TimelinePoint& crFramePoint);
+		// Records every pass that wasn't culled, with its barriers before it.
+		void Execute(VkCommandBuffer pCommandBuffer);
+
+		// Transient images only exist once the graph has been compiled, so passes look them up while executing.
+		VkImage GetImage(RenderResource resource) const;
+		VkImageView GetImageView(RenderResource resource) const;
+
+		// Where an imported image is left once the graph has executed, to import it with next time.
+		ImageState GetFinalState(RenderResource resource) const;
+		inline uint32_t GetCulledPassCount() const noexcept { return m_CulledPassCount; }
+		inline const TransientMemoryStatistics& GetTransientMemoryStatistics() const noexcept { return m_TransientMemoryStatistics; }
+		static void PrintTransientMemoryStatistics(std::ostream& rStream, const TransientMemoryStatistics& crStatistics);
+	private:
+		struct Resource
+		{
+			const char* cpName = nullptr;
+			VkImage pImage = VK_NULL_HANDLE;
+			VkBuffer pBuffer = VK_NULL_HANDLE;
+			VkImageAspectFlags aspectMask = 0;
+			// Into m_TransientImages once compiled. UINT32_MAX for imported resources, and transient images no pass uses.
+			uint32_t transientIndex = UINT32_MAX;
+			bool exported = false;
+			bool hasFinalUsage = false;
+			ResourceUsage finalUsage{};
+
+			// Tracked while compiling.
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			// The last write, or the stages of the imported state.
+			VkPipelineStageFlags2 writeStageMask = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2 writeAccessMask = VK_ACCESS_2_NONE;
+			// Reads since the last write, which the next write has to wait for.
+			VkPipelineStageFlags2 readStageMask = VK_PIPELINE_STAGE_2_NONE;
+			// Where the last write has already been made visible.
+			VkPipelineStageFlags2 visibleStageMask = VK_PIPELINE_STAGE_2_NONE;
+			VkAccessFlags2 visibleAccessMask = VK_ACCESS_2_NONE;
+			// Whether a pass that isn't culled, or an export, still needs what's written to it.
+			bool needed = false;
+		};
+
+		struct ResourceAccess
+		{
+			RenderResource resource = 0;
+			ResourceUsage usage{};
+		};
+
+		struct Pass
+		{
+			const char* cpName = nullptr;
+			ExecuteFunction execute;
+			uint32_t firstAccess = 0;
+			uint32_t accessCount = 0;
+			bool sideEffects = false;
+			bool culled = false;
+			uint32_t barrierBatch = 0;
+		};
+
+		struct TransientImage
+		{
+			// What decides whether last frame's images can be reused.
+			TransientImageDescription description;
+			VkImageUsageFlags usage = 0;
+			uint32_t firstPass = 0;
+			uint32_t lastPass = 0;
+
+			RenderResource resource = 0;
+			VkImage pImage = VK_NULL_HANDLE;
+			VkImageView pImageView = VK_NULL_HANDLE;
+			bool lazilyAllocated = false;
+			// The driver requires it to have its own memory, so it's left out of the heaps and never aliased.
+			bool dedicated = false;
+			Allocation dedicatedAllocation;
+			// Within its heap.
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			VkDeviceSize alignment = 0;
+			uint32_t memoryTypeBits = 0;
+			// Where the last frame left it, which anything aliasing it this frame has to wait for.
+			ImageState state;
+		};
+
+		// The barriers recorded before one pass, or after the last one.
+		struct BarrierBatch
+		{
+			uint32_t firstMemoryBarrier = 0;
+			uint32_t memoryBarrierCount = 0;
+			uint32_t firstImageBarrier = 0;
+			uint32_t imageBarrierCount = 0;
+		};
+	private:
+		void CullPasses();
+		void UpdateTransientImages(const TimelinePoint& crFramePoint);
+		void CreateTransientImages();
+		void RetireTransientImages(const TimelinePoint& crFramePoint);
+		// Places the heap's images so the ones whose lifetimes overlap don't overlap in memory. Returns the heap's size.
+		// Images that require a dedicated allocation aren't in either heap.
+		VkDeviceSize PlaceTransientImages(bool lazilyAllocated, VkDeviceSize& rAlignment, uint32_t& rMemoryTypeBits);
+		// The first use of a transient image waits for everything that used its memory before it, this frame or last.
+		void BeginTransientLifetime(Resource& rResource);
+		void AddBarriers(Resource& rResource, ResourceUsage usage);
+		void AddMemoryBarrier(VkPipelineStageFlags2 srcStageMask, VkAccessFlags2 srcAccessMask, VkPipelineStageFlags2 dstStageMask, VkAccessFlags2 dstAccessMask);
+		void RecordBarriers(VkCommandBuffer pCommandBuffer, const BarrierBatch& crBatch);
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		DeviceAllocator* m_pAllocator = nullptr;
+		DeletionQueue* m_pDeletionQueue = nullptr;
+
+		std::vector<Resource> m_Resources;
+		std::vector<Pass> m_Passes;
+		std::vector<ResourceAccess> m_Accesses;
+
+		std::vector<BarrierBatch> m_BarrierBatches;
+		std::vector<VkMemoryBarrier2> m_MemoryBarriers;
+		std::vector<VkImageMemoryBarrier2> m_ImageBarriers;
+
+		// This frame's transient images, before Compile() matches them against the ones that exist.
+		std::vector<TransientImage> m_RequestedTransientImages;
+		std::vector<TransientImage> m_TransientImages;
+		Allocation m_TransientAllocation;
+		Allocation m_LazyTransientAllocation;
+		TransientMemoryStatistics m_TransientMemoryStatistics;
+		// After the last pass, for the exports' final usages.
+		uint32_t m_FinalBarrierBatch = 0;
+		uint32_t m_CulledPassCount = 0;
+		bool m_Compiled = false;
+	};
+}
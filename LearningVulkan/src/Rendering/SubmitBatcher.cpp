@@ -0,0 +1,117 @@
+#include "Rendering/SubmitBatcher.h"
+#include "Core/Profiler.h"
+#include "Rendering/QueueTimeline.h"
+#include <assert.h>
+#include <algorithm>
+
+namespace rendering
+{
+	void SubmitBatcher::Create(const DeviceDispatch& crDispatch, VkQueue pQueue)
+	{
+		m_cpDispatch = &crDispatch;
+		m_pQueue = pQueue;
+	}
+
+	void SubmitBatcher::Destroy()
+	{
+		Flush();
+		m_Dependencies.clear();
+	}
+
+	void SubmitBatcher::AddDependency(SubmitBatcher& rDependency)
+	{
+		if (&rDependency != this && std::find(m_Dependencies.begin(), m_Dependencies.end(), &rDependency) == m_Dependencies.end())
+			m_Dependencies.push_back(&rDependency);
+	}
+
+	uint64_t SubmitBatcher::Add(QueueTimeline& rTimeline, std::span<const VkCommandBufferSubmitInfo> commandBuffers,
+		std::span<const VkSemaphoreSubmitInfo> waits, std::span<const VkSemaphoreSubmitInfo> signals)
+	{
+		std::lock_guard lock(m_Mutex);
+
+		// Values are handed out under the lock, so they're submitted in increasing order, as timelines require.
+		Batch& rBatch = m_Batches.emplace_back();
+		rBatch.pTimeline = &rTimeline;
+		rBatch.timelineValue = rTimeline.m_LastSubmittedValue.load(std::memory_order_relaxed) + 1;
+		rTimeline.m_LastSubmittedValue.store(rBatch.timelineValue, std::memory_order_release);
+
+		rBatch.firstCommandBuffer = static_cast<uint32_t>(m_CommandBufferInfos.size());
+		rBatch.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+		m_CommandBufferInfos.insert(m_CommandBufferInfos.end(), commandBuffers.begin(), commandBuffers.end());
+
+		rBatch.firstWait = static_cast<uint32_t>(m_WaitInfos.size());
+		rBatch.waitCount = static_cast<uint32_t>(waits.size());
+		m_WaitInfos.insert(m_WaitInfos.end(), waits.begin(), waits.end());
+
+		rBatch.firstSignal = static_cast<uint32_t>(m_SignalInfos.size());
+		rBatch.signalCount = static_cast<uint32_t>(signals.size() + 1);
+		m_SignalInfos.insert(m_SignalInfos.end(), signals.begin(), signals.end());
+
+		VkSemaphoreSubmitInfo& rTimelineSignal = m_SignalInfos.emplace_back();
+		rTimelineSignal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+		rTimelineSignal.semaphore = rTimeline.GetSemaphore();
+		rTimelineSignal.value = rBatch.timelineValue;
+		rTimelineSignal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+		return rBatch.timelineValue;
+	}
+
+	void SubmitBatcher::Flush()
+	{
+		FlushDependencies();
+		std::lock_guard lock(m_Mutex);
+		FlushLocked();
+	}
+
+	VkResult SubmitBatcher::Present(const VkPresentInfoKHR& crPresentInfo)
+	{
+		FlushDependencies();
+		std::lock_guard lock(m_Mutex);
+		FlushLocked();
+		return m_cpDispatch->vkQueuePresentKHR(m_pQueue, &crPresentInfo);
+	}
+
+	void SubmitBatcher::FlushDependencies()
+	{
+		// Dependencies include indirect ones, so they don't flush their own. That way two batchers that depend on each
+		// other, e.g. because two roles share a queue, can't recurse or take each other's locks in opposite orders.
+		for (SubmitBatcher* pDependency : m_Dependencies)
+		{
+			std::lock_guard lock(pDependency->m_Mutex);
+			pDependency->FlushLocked();
+		}
+	}
+
+	void SubmitBatcher::FlushLocked()
+	{
+		if (m_Batches.empty())
+			return;
+
+		PROFILE_FUNCTION();
+
+		m_SubmitInfos.clear();
+		for (const Batch& crBatch : m_Batches)
+		{
+			VkSubmitInfo2& rSubmitInfo = m_SubmitInfos.emplace_back();
+			rSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+			rSubmitInfo.waitSemaphoreInfoCount = crBatch.waitCount;
+			rSubmitInfo.pWaitSemaphoreInfos = m_WaitInfos.data() + crBatch.firstWait;
+			rSubmitInfo.commandBufferInfoCount = crBatch.commandBufferCount;
+			rSubmitInfo.pCommandBufferInfos = m_CommandBufferInfos.data() + crBatch.firstCommandBuffer;
+			rSubmitInfo.signalSemaphoreInfoCount = crBatch.signalCount;
+			rSubmitInfo.pSignalSemaphoreInfos = m_SignalInfos.data() + crBatch.firstSignal;
+		}
+
+		VkResult result = m_cpDispatch->vkQueueSubmit2(m_pQueue, static_cast<uint32_t>(m_SubmitInfos.size()), m_SubmitInfos.data(), VK_NULL_HANDLE);
+		assert(result == VK_SUCCESS && "Failed to submit batched submissions.");
+
+		// Batches are in increasing value order per timeline, so the last one is the highest.
+		for (const Batch& crBatch : m_Batches)
+			crBatch.pTimeline->m_FlushedValue.store(crBatch.timelineValue, std::memory_order_release);
+
+		m_Batches.clear();
+		m_CommandBufferInfos.clear();
+		m_WaitInfos.clear();
+		m_SignalInfos.clear();
+	}
+}
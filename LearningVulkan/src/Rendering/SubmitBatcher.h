@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Rendering/DeviceDispatch.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace rendering
+{
+	class QueueTimeline;
+
+	// Collects every submission to one queue, from every timeline that uses it, and submits them in order with a single
+	// vkQueueSubmit2 on Flush(), since each submit call has a lot of kernel driver overhead. It's also the queue's lock,
+	// so anything else that uses the queue (like presenting) has to go through it. All functions are thread safe.
+	class SubmitBatcher
+	{
+	public:
+		void Create(const DeviceDispatch& crDispatch, VkQueue pQueue);
+		void Destroy();
+
+		// A batcher whose timelines this one's batches may wait on, directly or through another dependency. Flush() and
+		// Present() flush dependencies first, so waiting on a value submitted here can't hang on a signal still sitting
+		// in another batcher. Not thread safe, add them before anything is submitted.
+		void AddDependency(SubmitBatcher& rDependency);
+
+		// Appends one batch that also signals the timeline's next value, which is returned.
+		uint64_t Add(QueueTimeline& rTimeline, std::span<const VkCommandBufferSubmitInfo> commandBuffers,
+			std::span<const VkSemaphoreSubmitInfo> waits, std::span<const VkSemaphoreSubmitInfo> signals);
+		// Submits everything added since the last flush, after everything added to the dependencies.
+		void Flush();
+
+		// Flushes first, so the presented image's semaphore signal has been submitted.
+		VkResult Present(const VkPresentInfoKHR& crPresentInfo);
+
+		inline VkQueue GetQueue() const noexcept { return m_pQueue; }
+	private:
+		struct Batch
+		{
+			QueueTimeline* pTimeline = nullptr;
+			uint64_t timelineValue = 0;
+			// Ranges in the shared arrays, which are only turned into pointers once nothing is added anymore.
+			uint32_t firstCommandBuffer = 0;
+			uint32_t commandBufferCount = 0;
+			uint32_t firstWait = 0;
+			uint32_t waitCount = 0;
+			uint32_t firstSignal = 0;
+			uint32_t signalCount = 0;
+		};
+	private:
+		void FlushDependencies();
+		void FlushLocked();
+	private:
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		VkQueue m_pQueue = VK_NULL_HANDLE;
+		std::vector<SubmitBatcher*> m_Dependencies;
+
+		std::mutex m_Mutex;
+		// Kept around so batching doesn't allocate every frame.
+		std::vector<Batch> m_Batches;
+		std::vector<VkCommandBufferSubmitInfo> m_CommandBufferInfos;
+		std::vector<VkSemaphoreSubmitInfo> m_WaitInfos;
+		std::vector<VkSemaphoreSubmitInfo> m_SignalInfos;
+		std::vector<VkSubmitInfo2> m_SubmitInfos;
+	};
+}
@@ -0,0 +1,42 @@
+#include "Rendering/Timeline.h"
+#include <assert.h>
+
+namespace rendering
+{
+	VkSemaphore CreateTimelineSemaphore(const DeviceDispatch& crDispatch, VkDevice pDevice, uint64_t initialValue)
+	{
+		VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo{};
+		semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		semaphoreTypeCreateInfo.initialValue = initialValue;
+
+		VkSemaphoreCreateInfo semaphoreCreateInfo{};
+		semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+		VkSemaphore pSemaphore;
+		VkResult result = crDispatch.vkCreateSemaphore(pDevice, &semaphoreCreateInfo, crDispatch.cpAllocationCallbacks, &pSemaphore);
+		assert(result == VK_SUCCESS && "Failed to create timeline semaphore.");
+		return pSemaphore;
+	}
+
+	void WaitTimelineSemaphore(const DeviceDispatch& crDispatch, VkDevice pDevice, VkSemaphore pSemaphore, uint64_t value)
+	{
+		VkSemaphoreWaitInfo semaphoreWaitInfo{};
+		semaphoreWaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		semaphoreWaitInfo.semaphoreCount = 1;
+		semaphoreWaitInfo.pSemaphores = &pSemaphore;
+		semaphoreWaitInfo.pValues = &value;
+
+		VkResult result = crDispatch.vkWaitSemaphores(pDevice, &semaphoreWaitInfo, UINT64_MAX);
+		assert(result == VK_SUCCESS && "Failed to wait for timeline semaphore.");
+	}
+
+	uint64_t GetTimelineSemaphoreValue(const DeviceDispatch& crDispatch, VkDevice pDevice, VkSemaphore pSemaphore)
+	{
+		uint64_t value;
+		VkResult result = crDispatch.vkGetSemaphoreCounterValue(pDevice, pSemaphore, &value);
+		assert(result == VK_SUCCESS && "Failed to get timeline semaphore value.");
+		return value;
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Rendering/DeviceDispatch.h"
+#define GLFW_INCLUDE_VULKAN
+#include <glfw/glfw3.h>
+
+namespace rendering
+{
+	// A GPU side wait on a timeline semaphore reaching a value, for submissions that depend on another queue's work.
+	struct TimelineWait
+	{
+		VkSemaphore pSemaphore = VK_NULL_HANDLE;
+		uint64_t value = 0;
+		VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	};
+
+	// A point on a timeline semaphore, e.g. the value a submission signals once it's done.
+	struct TimelinePoint
+	{
+		VkSemaphore pSemaphore = VK_NULL_HANDLE;
+		uint64_t value = 0;
+	};
+
+	VkSemaphore CreateTimelineSemaphore(const DeviceDispatch& crDispatch, VkDevice pDevice, uint64_t initialValue = 0);
+
+	// Blocks the calling thread until the semaphore reaches the value.
+	void WaitTimelineSemaphore(const DeviceDispatch& crDispatch, VkDevice pDevice, VkSemaphore pSemaphore, uint64_t value);
+	uint64_t GetTimelineSemaphoreValue(const DeviceDispatch& crDispatch, VkDevice pDevice, VkSemaphore pSemaphore);
+}
@@ -0,0 +1,252 @@
+#include "Rendering/UploadService.h"
+#include "Rendering/Memory.h"
+#include <assert.h>
+#include <cstring>
+#include <numeric>
+
+namespace rendering
+{
+	// Buffer to buffer copies have no offset rules, this just keeps the staged data aligned for memcpy.
+	static constexpr VkDeviceSize BUFFER_STAGING_ALIGNMENT = 16;
+
+	void UploadService::Create(VkDevice pDevice, const DeviceDispatch& crDispatch, DeviceAllocator& rAllocator, QueueTimeline& rTimeline, VkDeviceSize stagingCapacity)
+	{
+		m_pDevice = pDevice;
+		m_cpDispatch = &crDispatch;
+		m_pAllocator = &rAllocator;
+		m_pTimeline = &rTimeline;
+		m_StagingCapacity = stagingCapacity;
+
+		// Create the staging ring buffer.
+		VkBufferCreateInfo bufferCreateInfo{};
+		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferCreateInfo.size = stagingCapacity;
+		bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		VkResult result = m_cpDispatch->vkCreateBuffer(m_pDevice, &bufferCreateInfo, m_cpDispatch->cpAllocationCallbacks, &m_pStagingBuffer);
+		assert(result == VK_SUCCESS && "Failed to create staging buffer.");
+
+		// The ring lives as long as the service, so it gets its own memory instead of taking up most of a block.
+		AllocationCreateInfo allocationCreateInfo;
+		allocationCreateInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		allocationCreateInfo.preferredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		allocationCreateInfo.dedicated = true;
+		allocationCreateInfo.mapped = true;
+		m_StagingAllocation = m_pAllocator->AllocateBuffer(m_pStagingBuffer, allocationCreateInfo);
+		m_pStagingData = static_cast<uint8_t*>(m_StagingAllocation.pMappedData);
+	}
+
+	void UploadService::Destroy()
+	{
+		Flush();
+		Wait(GetLastSubmittedValue());
+		RecycleFinishedBatches(false);
+		assert(m_PendingBatches.empty() && m_RecordingBatch.pCommandBuffer == VK_NULL_HANDLE && "Upload batches are still in flight.");
+
+		for (Batch& rBatch : m_FreeBatches)
+			m_cpDispatch->vkDestroyCommandPool(m_pDevice, rBatch.pCommandPool, m_cpDispatch->cpAllocationCallbacks);
+		m_FreeBatches.clear();
+
+		m_cpDispatch->vkDestroyBuffer(m_pDevice, m_pStagingBuffer, m_cpDispatch->cpAllocationCallbacks);
+		m_pAllocator->Free(m_StagingAllocation);
+	}
+
+	uint64_t UploadService::UploadBuffer(VkBuffer pDestination, VkDeviceSize destinationOffset, const void* cpData, VkDeviceSize size)
+	{
+		std::lock_guard lock(m_Mutex);
+
+		uint64_t position = AllocateStaging(size, BUFFER_STAGING_ALIGNMENT);
+		memcpy(m_pStagingData + position % m_StagingCapacity, cpData, static_cast<size_t>(size));
+
+		VkBufferCopy bufferCopy{};
+		bufferCopy.srcOffset = position % m_StagingCapacity;
+		bufferCopy.dstOffset = destinationOffset;
+		bufferCopy.size = size;
+		m_cpDispatch->vkCmdCopyBuffer(GetRecordingCommandBuffer(), m_pStagingBuffer, pDestination, 1, &bufferCopy);
+
+		return m_pTimeline->GetNextValue();
+	}
+
+	uint64_t UploadService::UploadImage(VkImage pDestination, const VkImageSubresourceLayers& crSubresource, VkExtent3D extent,
+		VkDeviceSize texelBlockSize, const void* cpData, VkDeviceSize size, VkImageLayout finalLayout)
+	{
+		assert(texelBlockSize != 0 && "Image uploads need the format's texel block size.");
+		std::lock_guard lock(m_Mutex);
+
+		// bufferOffset has to be a multiple of the texel block size, and of 4 for depth/stencil formats and transfer queues.
+		uint64_t position = AllocateStaging(size, std::lcm(texelBlockSize, VkDeviceSize(4)));
+		memcpy(m_pStagingData + position % m_StagingCapacity, cpData, static_cast<size_t>(size));
+
+		VkCommandBuffer pCommandBuffer = GetRecordingCommandBuffer();
+
+		VkImageMemoryBarrier2 imageMemoryBarrier{};
+		imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageMemoryBarrier.image = pDestination;
+		imageMemoryBarrier.subresourceRange.aspectMask = crSubresource.aspectMask;
+		imageMemoryBarrier.subresourceRange.baseMipLevel = crSubresource.mipLevel;
+		imageMemoryBarrier.subresourceRange.levelCount = 1;
+		imageMemoryBarrier.subresourceRange.baseArrayLayer = crSubresource.baseArrayLayer;
+		imageMemoryBarrier.subresourceRange.layerCount = crSubresource.layerCount;
+
+		VkDependencyInfo dependencyInfo{};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.imageMemoryBarrierCount = 1;
+		dependencyInfo.pImageMemoryBarriers = &imageMemoryBarrier;
+
+		imageMemoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+		imageMemoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		m_cpDispatch->vkCmdPipelineBarrier2(pCommandBuffer, &dependencyInfo);
+
+		VkBufferImageCopy bufferImageCopy{};
+		bufferImageCopy.bufferOffset = position % m_StagingCapacity;
+		bufferImageCopy.imageSubresource = crSubresource;
+		bufferImageCopy.imageExtent = extent;
+		m_cpDispatch->vkCmdCopyBufferToImage(pCommandBuffer, m_pStagingBuffer, pDestination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferImageCopy);
+
+		// The graphics queue's timeline semaphore wait makes the copy visible, so no destination access is needed here.
+		imageMemoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		imageMemoryBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		imageMemoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		imageMemoryBarrier.dstAccessMask = VK_ACCESS_2_NONE;
+		imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageMemoryBarrier.newLayout = finalLayout;
+		m_cpDispatch->vkCmdPipelineBarrier2(pCommandBuffer, &dependencyInfo);
+
+		return m_pTimeline->GetNextValue();
+	}
+
+	void UploadService::Flush()
+	{
+		std::lock_guard lock(m_Mutex);
+		FlushLocked();
+		RecycleFinishedBatches(false);
+	}
+
+	void UploadService::Wait(uint64_t value)
+	{
+		{
+			// The value might belong to the batch that's still being recorded.
+			std::lock_guard lock(m_Mutex);
+			if (value > m_pTimeline->GetLastSubmittedValue())
+				FlushLocked();
+		}
+
+		m_pTimeline->Wait(value);
+	}
+
+	uint64_t UploadService::AllocateStaging(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		assert(size + alignment <= m_StagingCapacity && "Upload is larger than the staging ring buffer.");
+
+		while (true)
+		{
+			// The offset into the buffer is what has to be aligned, and the capacity may not be a multiple of the alignment.
+			// Don't let an allocation wrap around the end of the ring.
+			uint64_t headOffset = m_StagingHead % m_StagingCapacity;
+			uint64_t offset = AlignUp(headOffset, alignment);
+			uint64_t position = m_StagingHead - headOffset + offset;
+			if (offset + size > m_StagingCapacity)
+				position += m_StagingCapacity - offset;
+
+			if (position + size - m_StagingTail <= m_StagingCapacity)
+			{
+				m_StagingHead = position + size;
+				return position;
+			}
+
+			// The ring is full. If only the batch being recorded holds on to it, it has to be submitted before it can be waited on.
+			if (m_PendingBatches.empty())
+				FlushLocked();
+			RecycleFinishedBatches(true);
+		}
+	}
+
+	VkCommandBuffer UploadService::GetRecordingCommandBuffer()
+	{
+		if (m_RecordingBatch.pCommandBuffer != VK_NULL_HANDLE)
+			return m_RecordingBatch.pCommandBuffer;
+
+		if (!m_FreeBatches.empty())
+		{
+			m_RecordingBatch = m_FreeBatches.back();
+			m_FreeBatches.pop_back();
+		}
+		else
+		{
+			VkCommandPoolCreateInfo commandPoolCreateInfo{};
+			commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			commandPoolCreateInfo.queueFamilyIndex = m_pTimeline->GetQueueFamilyIndex();
+
+			VkResult result = m_cpDispatch->vkCreateCommandPool(m_pDevice, &commandPoolCreateInfo, m_cpDispatch->cpAllocationCallbacks, &m_RecordingBatch.pCommandPool);
+			assert(result == VK_SUCCESS && "Failed to create upload command pool.");
+
+			VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+			commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			commandBufferAllocateInfo.commandPool = m_RecordingBatch.pCommandPool;
+			commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			commandBufferAllocateInfo.commandBufferCount = 1;
+
+			result = m_cpDispatch->vkAllocateCommandBuffers(m_pDevice, &commandBufferAllocateInfo, &m_RecordingBatch.pCommandBuffer);
+			assert(result == VK_SUCCESS && "Failed to allocate upload command buffer.");
+		}
+
+		VkCommandBufferBeginInfo commandBufferBeginInfo{};
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		VkResult result = m_cpDispatch->vkBeginCommandBuffer(m_RecordingBatch.pCommandBuffer, &commandBufferBeginInfo);
+		assert(result == VK_SUCCESS && "Failed to begin upload command buffer.");
+		return m_RecordingBatch.pCommandBuffer;
+	}
+
+	void UploadService::FlushLocked()
+	{
+		if (m_RecordingBatch.pCommandBuffer == VK_NULL_HANDLE)
+			return;
+
+		VkResult result = m_cpDispatch->vkEndCommandBuffer(m_RecordingBatch.pCommandBuffer);
+		assert(result == VK_SUCCESS && "Failed to end upload command buffer.");
+
+		m_pAllocator->FlushMapped(m_StagingAllocation);
+
+		m_RecordingBatch.stagingEnd = m_StagingHead;
+
+		VkCommandBufferSubmitInfo commandBufferSubmitInfo{};
+		commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+		commandBufferSubmitInfo.commandBuffer = m_RecordingBatch.pCommandBuffer;
+		m_RecordingBatch.timelineValue = m_pTimeline->Enqueue({ &commandBufferSubmitInfo, 1 });
+
+		m_PendingBatches.push_back(m_RecordingBatch);
+		m_RecordingBatch = {};
+	}
+
+	void UploadService::RecycleFinishedBatches(bool waitForOldest)
+	{
+		if (m_PendingBatches.empty())
+			return;
+
+		if (waitForOldest)
+			m_pTimeline->Wait(m_PendingBatches.front().timelineValue);
+
+		uint64_t completedValue = m_pTimeline->GetCompletedValue();
+		while (!m_PendingBatches.empty() && m_PendingBatches.front().timelineValue <= completedValue)
+		{
+			Batch& rBatch = m_PendingBatches.front();
+			m_StagingTail = rBatch.stagingEnd;
+
+			VkResult result = m_cpDispatch->vkResetCommandPool(m_pDevice, rBatch.pCommandPool, 0);
+			assert(result == VK_SUCCESS && "Failed to reset upload command pool.");
+
+			m_FreeBatches.push_back(rBatch);
+			m_PendingBatches.pop_front();
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Rendering/DeviceAllocator.h"
+#include "Rendering/QueueTimeline.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace rendering
+{
+	// Streams buffer and image data to the GPU on the transfer queue, so uploads don't stall the graphics queue.
+	// Data is copied into a persistently mapped staging ring buffer and the copies are batched into one submission
+	// per Flush(). Each batch signals the transfer timeline, which the graphics queue waits on before using the data.
+	//
+	// If the transfer and graphics queue families differ, destination resources must be created with
+	// VK_SHARING_MODE_CONCURRENT across both families, since no queue family ownership transfers are done.
+	// All functions are thread safe.
+	class UploadService
+	{
+	public:
+		// The service must be the only one submitting to the timeline, since it hands out values before submitting them.
+		void Create(VkDevice pDevice, const DeviceDispatch& crDispatch, DeviceAllocator& rAllocator, QueueTimeline& rTimeline, VkDeviceSize stagingCapacity);
+		void Destroy();
+
+		// Returns the timeline value that'll be signaled once the upload is done.
+		uint64_t UploadBuffer(VkBuffer pDestination, VkDeviceSize destinationOffset, const void* cpData, VkDeviceSize size);
+		// Uploads tightly packed texels into one subresource, then transitions it from undefined to finalLayout.
+		// texelBlockSize is the size in bytes of one texel, or of one block for compressed formats.
+		uint64_t UploadImage(VkImage pDestination, const VkImageSubresourceLayers& crSubresource, VkExtent3D extent,
+			VkDeviceSize texelBlockSize, const void* cpData, VkDeviceSize size, VkImageLayout finalLayout);
+
+		// Hands everything recorded since the last flush to the transfer queue's batcher as one batch.
+		void Flush();
+
+		// Blocks until the given timeline value has been signaled.
+		void Wait(uint64_t value);
+
+		inline VkSemaphore GetTimelineSemaphore() const noexcept { return m_pTimeline->GetSemaphore(); }
+		inline uint64_t GetLastSubmittedValue() const noexcept { return m_pTimeline->GetLastSubmittedValue(); }
+	private:
+		struct Batch
+		{
+			VkCommandPool pCommandPool = VK_NULL_HANDLE;
+			VkCommandBuffer pCommandBuffer = VK_NULL_HANDLE;
+			uint64_t timelineValue = 0;
+			// Where the staging ring's tail can move to once this batch is done.
+			uint64_t stagingEnd = 0;
+		};
+	private:
+		// Returns the ring position to write size bytes to, waiting for old batches to finish if the ring is full.
+		uint64_t AllocateStaging(VkDeviceSize size, VkDeviceSize alignment);
+		VkCommandBuffer GetRecordingCommandBuffer();
+		void FlushLocked();
+		void RecycleFinishedBatches(bool waitForOldest);
+	private:
+		VkDevice m_pDevice = VK_NULL_HANDLE;
+		const DeviceDispatch* m_cpDispatch = nullptr;
+		DeviceAllocator* m_pAllocator = nullptr;
+		QueueTimeline* m_pTimeline = nullptr;
+
+		VkBuffer m_pStagingBuffer = VK_NULL_HANDLE;
+		Allocation m_StagingAllocation;
+		uint8_t* m_pStagingData = nullptr;
+		VkDeviceSize m_StagingCapacity = 0;
+		// Monotonic ring positions, the actual offset is the position modulo the capacity.
+		uint64_t m_StagingHead = 0;
+		uint64_t m_StagingTail = 0;
+
+		Batch m_RecordingBatch;
+		std::deque<Batch> m_PendingBatches;
+		std::vector<Batch> m_FreeBatches;
+
+		std::mutex m_Mutex;
+	};
+}
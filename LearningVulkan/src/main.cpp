@@ -1,18 +1,50 @@
 #if SYSTEM_WINDOWS
 
 #include "Core/Application.h"
+#include "Core/Profiler.h"
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 int Main(int argc, char** argv)
 {
-	static_cast<void>(argc, argv);
+	// --headless renders offscreen without a window, --frames <count> stops after that many frames,
+	// --device <name|uuid> picks a physical device instead of the highest scoring one,
+	// --job-workers <count> sets how many job system workers run besides the main thread,
+	// --trace <file> writes a Chrome trace of startup and every frame on exit (Profile configuration only),
+	// --frame-stats <file> writes every frame's timings as CSV.
+	core::ApplicationSpecification specification;
+	const char* cpTraceFilepath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+			specification.headless = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			specification.frameLimit = std::strtoull(argv[++i], nullptr, 10);
+		else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)
+			specification.preferredDevice = argv[++i];
+		else if (strcmp(argv[i], "--job-workers") == 0 && i + 1 < argc)
+			specification.jobWorkerCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		else if (strcmp(argv[i], "--frame-stats") == 0 && i + 1 < argc)
+			specification.frameStatisticsFilepath = argv[++i];
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			cpTraceFilepath = argv[++i];
+	}
 
-	core::Application* pApplication = new core::Application();
+	core::Application* pApplication = new core::Application(specification);
 	pApplication->Run();
 	delete pApplication;
 
+#if CONFIG_PROFILE
+	if (cpTraceFilepath && !core::Profiler::WriteTrace(cpTraceFilepath))
+		std::cerr << "Failed to write trace \"" << cpTraceFilepath << "\".\n";
+#else
+	static_cast<void>(cpTraceFilepath);
+#endif
+
 	std::cout << "Application completed.\n";
-	std::cin.get();
+	if (!specification.headless)
+		std::cin.get();
 
 	return 0;
 }
@@ -42,3 +42,4 @@ group ""
 
 -- Add any projects here with 'include "__PROJECT_NAME__"'
 include "LearningVulkan"
+include "Benchmark"